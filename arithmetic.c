@@ -6,6 +6,7 @@
 */
 
 #include <assert.h>
+#include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <gmp.h>
@@ -33,13 +34,22 @@ void subtract_gmp(enum subtract_mode mode, mpq_t op, double x, double y) {
     mpq_clear(qy);
 }
 
-void subtract_exact(
+void subtract_gmp_ext(mpq_t op, bool d0, double x, bool d1, double y) {
+    if          ((d0 == 0) && (d1 == 0)) {subtract_gmp(SUB_0, op, x, y);}
+    else if     ((d0 == 1) && (d1 == 1)) {subtract_gmp(SUB_0, op, y, x);}
+    else if     ((d0 == 1) && (d1 == 0)) {subtract_gmp(SUB_1, op, x, y);}
+    else                                 {exit(EXIT_FAILURE);}
+}
+
+void subtract_exact64(
         enum subtract_mode mode,
-        float x,
-        float y,
-        struct subtract_exact_s * ss
+        double x,
+        double y,
+        struct subtract_exact64_s * ss
         ) {
 
+    // As subtract_exact, where the significands have DBL_SIZE_M + 1 bits,
+    // so that every field fits in a 64-bit integer.
     switch (mode) {
 
         case SUB_0:
@@ -50,67 +60,60 @@ void subtract_exact(
         case SUB_1:
             assert(!((x == .5) && (y == .5)));
             assert(!((x == 0.) && (y == 0.)));
-            float xx = max(x, y);
-            float yy = min(x, y);
+            double xx = max(x, y);
+            double yy = min(x, y);
             x = xx;
             y = yy;
             break;
     }
 
-    union float_bits fields_x = {.f = x};
-    union float_bits fields_y = {.f = y};
+    union double_bits fields_x = {.f = x};
+    union double_bits fields_y = {.f = y};
 
     unsigned int e_x = fields_x.b.exponent;
     unsigned int e_y = fields_y.b.exponent;
 
-    int32_t Emax = (1 << (FLT_SIZE_E - 1)) - 1;
+    int32_t Emax = (1 << (DBL_SIZE_E - 1)) - 1;
     int32_t ehat_x = e_x - Emax + (e_x == 0);
     int32_t ehat_y = e_y - Emax + (e_y == 0);
 
-    unsigned int m_x = fields_x.b.mantissa;
-    unsigned int m_y = fields_y.b.mantissa;
-    int32_t f_x = m_x + ((int32_t)(e_x > 0) << FLT_SIZE_M);
-    int32_t f_y = m_y + ((int32_t)(e_y > 0) << FLT_SIZE_M);
+    uint64_t m_x = fields_x.b.mantissa;
+    uint64_t m_y = fields_y.b.mantissa;
+    int64_t f_x = m_x + ((int64_t)(e_x > 0) << DBL_SIZE_M);
+    int64_t f_y = m_y + ((int64_t)(e_y > 0) << DBL_SIZE_M);
 
-    int32_t f_hi = f_y >> min(ehat_x - ehat_y, FLT_SIZE - 1);
-    int32_t f_lo = f_y & ((1 << min(ehat_x - ehat_y, FLT_SIZE_M+1)) - 1);
+    int64_t f_hi = f_y >> min(ehat_x - ehat_y, DBL_SIZE - 1);
+    int64_t f_lo = f_y & ((1ll << min(ehat_x - ehat_y, DBL_SIZE_M+1)) - 1);
 
     switch (mode) {
 
         case SUB_0:
             ss->n_1 = -ehat_x - 1 + (x == 1);
-            ss->n_2 = max((ehat_x - ehat_y) - (FLT_SIZE_M + 1), 0);
-            ss->n_hi = FLT_SIZE_M + 1 - (x == 1);
-            ss->n_lo = min(ehat_x - ehat_y , FLT_SIZE_M + 1);
+            ss->n_2 = max((ehat_x - ehat_y) - (DBL_SIZE_M + 1), 0);
+            ss->n_hi = DBL_SIZE_M + 1 - (x == 1);
+            ss->n_lo = min(ehat_x - ehat_y , DBL_SIZE_M + 1);
             ss->b_1 = 0;
             ss->b_2 = f_lo > 0;
             ss->g_hi = f_x - f_hi - ss->b_2;
-            ss->g_lo = (ss->b_2 << ss->n_lo) - f_lo;
+            ss->g_lo = ((int64_t) ss->b_2 << ss->n_lo) - f_lo;
             break;
 
         case SUB_1:
             ss->n_1 = -ehat_x - 2 + (x == .5);
-            ss->n_2 = max((ehat_x - ehat_y) - (FLT_SIZE_M + 1), 0);
-            ss->n_hi = FLT_SIZE_M + 2 - (x == .5);
-            ss->n_lo = min(ehat_x - ehat_y , FLT_SIZE_M + 1);
+            ss->n_2 = max((ehat_x - ehat_y) - (DBL_SIZE_M + 1), 0);
+            ss->n_hi = DBL_SIZE_M + 2 - (x == .5);
+            ss->n_lo = min(ehat_x - ehat_y , DBL_SIZE_M + 1);
             ss->b_1 = 1;
             ss->b_2 = f_lo > 0;
-            ss->g_hi = (1 << ss->n_hi) - f_x - f_hi - ss->b_2;
-            ss->g_lo = (ss->b_2 << ss->n_lo) - f_lo;
+            ss->g_hi = (1ll << ss->n_hi) - f_x - f_hi - ss->b_2;
+            ss->g_lo = ((int64_t) ss->b_2 << ss->n_lo) - f_lo;
     }
 }
 
-void subtract_gmp_ext(mpq_t op, bool d0, double x, bool d1, double y) {
-    if          ((d0 == 0) && (d1 == 0)) {subtract_gmp(SUB_0, op, x, y);}
-    else if     ((d0 == 1) && (d1 == 1)) {subtract_gmp(SUB_0, op, y, x);}
-    else if     ((d0 == 1) && (d1 == 0)) {subtract_gmp(SUB_1, op, x, y);}
-    else                                 {exit(EXIT_FAILURE);}
-}
-
-void subtract_exact_ext(bool d0, float x, bool d1, float y, struct subtract_exact_s * ss){
-    if          ((d0 == 0) && (d1 == 0)) {subtract_exact(SUB_0, x, y, ss);}
-    else if     ((d0 == 1) && (d1 == 1)) {subtract_exact(SUB_0, y, x, ss);}
-    else if     ((d0 == 1) && (d1 == 0)) {subtract_exact(SUB_1, x, y, ss);}
+void subtract_exact64_ext(bool d0, double x, bool d1, double y, struct subtract_exact64_s * ss){
+    if          ((d0 == 0) && (d1 == 0)) {subtract_exact64(SUB_0, x, y, ss);}
+    else if     ((d0 == 1) && (d1 == 1)) {subtract_exact64(SUB_0, y, x, ss);}
+    else if     ((d0 == 1) && (d1 == 0)) {subtract_exact64(SUB_1, x, y, ss);}
     else                                 {exit(EXIT_FAILURE);}
 }
 
@@ -156,45 +159,143 @@ unsigned char ith_bit_of_fraction_gmp(mpz_t k, mpz_t n, uintmax_t i) {
     return b;
 }
 
-unsigned char ith_bit_of_exact(struct subtract_exact_s * ss, uint32_t l) {
-    // TODO, remove duplication.
+unsigned char ith_bit_of_exact64(const struct subtract_exact64_s * ss, uint32_t l) {
     int32_t n_1  = ss->n_1;
     int32_t n_2  = ss->n_2;
     int32_t n_hi = ss->n_hi;
     int32_t n_lo = ss->n_lo;
-    short b_1    = ss->b_1;
-    short b_2    = ss->b_2;
-    int32_t g_hi = ss->g_hi;
-    int32_t g_lo = ss->g_lo;
     if (l <= n_1) {
-        return b_1;
+        return ss->b_1;
     }
     else if (l <= n_1 + n_hi) {
-        assert(g_hi < (1 << n_hi));
-        return (g_hi >> (n_hi - (l - n_1))) & 1;
+        assert(ss->g_hi < (1ll << n_hi));
+        return (ss->g_hi >> (n_hi - (l - n_1))) & 1;
     }
     else if (l <= n_1 + n_hi + n_2) {
-        return b_2;
+        return ss->b_2;
     }
     else if (l <= n_1 + n_hi + n_2 + n_lo) {
-        assert(g_lo < (1 << n_lo));
-        return (g_lo >> (n_lo - (l - (n_1 + n_hi + n_2)))) & 1;
+        assert(ss->g_lo < (1ll << n_lo));
+        return (ss->g_lo >> (n_lo - (l - (n_1 + n_hi + n_2)))) & 1;
     } else {
         return 0;
     }
 }
 
-bool check_ddf_val(bool d, float q) {
+extern inline unsigned char ith_bit_of_exact(const struct subtract_exact_s * ss, uint32_t l);
+extern inline uint64_t window_of_exact(const struct subtract_exact_s * ss, uint32_t l);
+extern inline uint64_t window_of_exact64(const struct subtract_exact64_s * ss, uint32_t l);
+
+extern inline void subtract_exact(enum subtract_mode mode, float x, float y, struct subtract_exact_s * ss);
+extern inline void subtract_exact_ext(bool d0, float x, bool d1, float y, struct subtract_exact_s * ss);
+
+extern inline bool check_ddf_val(bool d, float q);
+extern inline bool compare_lte_ext(bool d0, float q0, bool d1, float q1);
+
+bool check_ddf64_val(bool d, double q) {
     return
         ((d == 0) && (0 <= q) && (q <= 0.5))
         ||
         ((d == 1) && (0 <= q) && (q < 0.5));
 }
 
-bool compare_lte_ext(bool d0, float q0, bool d1, float q1) {
-    assert(check_ddf_val(d0, q0));
-    assert(check_ddf_val(d1, q1));
+bool compare_lte_ext64(bool d0, double q0, bool d1, double q1) {
+    assert(check_ddf64_val(d0, q0));
+    assert(check_ddf64_val(d1, q1));
     return (d0 < d1)
             || ((d0 == 0) && (d1 == 0) && (q0 <= q1))
             || ((d0 == 1) && (d1 == 1) && (q1 <= q0));
 }
+
+// ================ Fixed-Point Arithmetic ================
+
+void fix_from_float(float f, fix_t w) {
+    // A float of 2^66 or more would be shifted past w[FIX_WORDS - 1].
+    assert((0 <= f) && (f <= 1));
+    if (!(f <= 1)) {
+        f = 1;
+    } else if (f < 0) {
+        f = 0;
+    }
+    union float_bits fields = {.f = f};
+    uint64_t v = fields.b.mantissa;
+    unsigned int shift = 0;
+    if (fields.b.exponent > 0) {
+        v |= 1ull << FLT_SIZE_M;
+        shift = fields.b.exponent - 1;
+    }
+    w[0] = w[1] = w[2] = 0;
+    unsigned int q = shift / 64;
+    unsigned int r = shift % 64;
+    w[q] = v << r;
+    if ((r > 0) && (q + 1 < FIX_WORDS)) {
+        w[q + 1] = v >> (64 - r);
+    }
+}
+
+void fix_from_ddf(bool d, float q, fix_t w) {
+    fix_from_float(q, w);
+    if (d) {
+        fix_t one;
+        fix_from_float(1, one);
+        fix_sub(one, w, w);
+    }
+}
+
+void fix_sub(const fix_t x, const fix_t y, fix_t z) {
+    unsigned char borrow = 0;
+    for (int i = 0; i < FIX_WORDS; i++) {
+        uint64_t d = x[i] - y[i];
+        unsigned char b = (x[i] < y[i]) || (d < borrow);
+        z[i] = d - borrow;
+        borrow = b;
+    }
+}
+
+void fix_shl1(fix_t w) {
+    for (int i = FIX_WORDS - 1; 0 < i; i--) {
+        w[i] = (w[i] << 1) | (w[i - 1] >> 63);
+    }
+    w[0] <<= 1;
+}
+
+int fix_cmp(const fix_t x, const fix_t y) {
+    for (int i = FIX_WORDS - 1; 0 <= i; i--) {
+        if (x[i] != y[i]) { return (x[i] < y[i]) ? -1 : 1; }
+    }
+    return 0;
+}
+
+bool fix_bit(const fix_t w, unsigned int i) {
+    return (w[i / 64] >> (i % 64)) & 1;
+}
+
+bool fix_zero(const fix_t w) {
+    return (w[0] | w[1] | w[2]) == 0;
+}
+
+// Lowest set bit of a nonzero w.
+unsigned int fix_ctz(const fix_t w) {
+    for (int i = 0; i < FIX_WORDS; i++) {
+        if (w[i] != 0) { return 64 * i + __builtin_ctzll(w[i]); }
+    }
+    assert(0);
+    return 0;
+}
+
+// Shift w right by k < FIX_BITS bits.
+void fix_shr(fix_t w, unsigned int k) {
+    unsigned int q = k / 64;
+    unsigned int r = k % 64;
+    for (int i = 0; i < FIX_WORDS; i++) {
+        uint64_t lo = (i + q < FIX_WORDS) ? w[i + q] : 0;
+        uint64_t hi = (i + q + 1 < FIX_WORDS) ? w[i + q + 1] : 0;
+        w[i] = (r == 0) ? lo : (lo >> r) | (hi << (64 - r));
+    }
+}
+
+// Value w 2^-149 of w, rounded to a double.
+double fix_to_double(const fix_t w) {
+    double x = ldexp((double) w[2], 128) + ldexp((double) w[1], 64) + (double) w[0];
+    return ldexp(x, 1 - FIX_BITS);
+}
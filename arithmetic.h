@@ -8,10 +8,14 @@
 #ifndef ARITHMETIC_H
 #define ARITHMETIC_H
 
+#include <assert.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <gmp.h>
 
+#include "bits.h"
+
 // Macros for min and max.
 #define max(a, b)            \
 ({                           \
@@ -38,20 +42,230 @@ struct subtract_exact_s {
     int32_t g_lo;
 };
 
+// As subtract_exact_s, for the difference of two doubles, where g_hi has
+// at most DBL_SIZE_M + 2 bits and g_lo at most DBL_SIZE_M + 1 bits.
+struct subtract_exact64_s {
+    int32_t n_1;
+    int32_t n_2;
+    int32_t n_hi;
+    int32_t n_lo;
+    short b_1;
+    short b_2;
+    int64_t g_hi;
+    int64_t g_lo;
+};
+
 // Compute the ith bit of the fraction k/n.
 unsigned char ith_bit_of_fraction(uintmax_t k, uintmax_t n, uintmax_t i);
 unsigned char ith_bit_of_fraction_gmp(mpz_t k, mpz_t n, uintmax_t i);
-unsigned char ith_bit_of_exact(struct subtract_exact_s * ss, uint32_t l);
+unsigned char ith_bit_of_exact64(const struct subtract_exact64_s * ss, uint32_t l);
+
+// The functions on `subtract_exact_s` and on DDF values below are inline
+// since they are called at every level of the generators. Each external
+// definition is in arithmetic.c.
+
+inline unsigned char ith_bit_of_exact(const struct subtract_exact_s * ss, uint32_t l) {
+    // TODO, remove duplication.
+    int32_t n_1  = ss->n_1;
+    int32_t n_2  = ss->n_2;
+    int32_t n_hi = ss->n_hi;
+    int32_t n_lo = ss->n_lo;
+    short b_1    = ss->b_1;
+    short b_2    = ss->b_2;
+    int32_t g_hi = ss->g_hi;
+    int32_t g_lo = ss->g_lo;
+    if (l <= n_1) {
+        return b_1;
+    }
+    else if (l <= n_1 + n_hi) {
+        assert(g_hi < (1 << n_hi));
+        return (g_hi >> (n_hi - (l - n_1))) & 1;
+    }
+    else if (l <= n_1 + n_hi + n_2) {
+        return b_2;
+    }
+    else if (l <= n_1 + n_hi + n_2 + n_lo) {
+        assert(g_lo < (1 << n_lo));
+        return (g_lo >> (n_lo - (l - (n_1 + n_hi + n_2)))) & 1;
+    } else {
+        return 0;
+    }
+}
+
+// Window positions k, ..., 63, where position i is bit 63 - i.
+#define EXACT_WINDOW_FROM(k) \
+    (((k) <= 0) ? UINT64_MAX : ((64 <= (k)) ? 0 : (UINT64_MAX >> (k))))
+
+// Field g of n <= 64 bits, most significant first, at window positions
+// k, ..., k + n - 1. It is placed in the upper word of a double word, so
+// that the bits on either side of the window are lost.
+#define EXACT_WINDOW_FIELD(g, k, n) \
+    (((0 < (k) + (n)) && ((k) + (n) < 128)) \
+        ? (uint64_t) (((unsigned __int128) (uint64_t) (g) << (128 - (k) - (n))) >> 64) \
+        : 0)
+
+// Window of the run of n_1 bits b_1, the n_hi bits of g_hi, the run of n_2
+// bits b_2, and the n_lo bits of g_lo, starting at bit l of the fraction.
+#define EXACT_WINDOW(ss, l) ({                                                  \
+    int32_t k_1__ = 1 - (int32_t) (l);                                          \
+    int32_t k_hi__ = k_1__ + (ss)->n_1;                                         \
+    int32_t k_2__ = k_hi__ + (ss)->n_hi;                                        \
+    int32_t k_lo__ = k_2__ + (ss)->n_2;                                         \
+    ((EXACT_WINDOW_FROM(k_1__) & ~EXACT_WINDOW_FROM(k_hi__)) & -(uint64_t) (ss)->b_1) \
+    | EXACT_WINDOW_FIELD((ss)->g_hi, k_hi__, (ss)->n_hi)                        \
+    | ((EXACT_WINDOW_FROM(k_2__) & ~EXACT_WINDOW_FROM(k_lo__)) & -(uint64_t) (ss)->b_2) \
+    | EXACT_WINDOW_FIELD((ss)->g_lo, k_lo__, (ss)->n_lo);                       \
+})
+
+// Bits l, l+1, ..., l+63 of the fraction represented by `ss`, where bit
+// 63 - i of the result is bit l+i of the fraction and l > 0. The parts are
+// combined without branches since those that overlap the window are
+// unpredictable. The function is inline since it is called in the inner
+// loop of `generate_opt_split`, and its external definition is in
+// arithmetic.c.
+inline uint64_t window_of_exact(const struct subtract_exact_s * ss, uint32_t l) {
+    assert(0 < l);
+    uint64_t w = EXACT_WINDOW(ss, l);
+    #ifndef NDEBUG
+    for (uint32_t i = 0; i < 64; i++) {
+        assert(((w >> (63 - i)) & 1) == ith_bit_of_exact(ss, l + i));
+    }
+    #endif
+    return w;
+}
+
+// As `window_of_exact`, for the difference of two doubles.
+inline uint64_t window_of_exact64(const struct subtract_exact64_s * ss, uint32_t l) {
+    assert(0 < l);
+    uint64_t w = EXACT_WINDOW(ss, l);
+    #ifndef NDEBUG
+    for (uint32_t i = 0; i < 64; i++) {
+        assert(((w >> (63 - i)) & 1) == ith_bit_of_exact64(ss, l + i));
+    }
+    #endif
+    return w;
+}
 
 // Compute exact subtraction of x - y (SUB_0) or 1 - (x+y) (SUB_1).
 enum subtract_mode {SUB_0, SUB_1};
 void subtract_gmp(enum subtract_mode mode, mpq_t op, double x , double y);
-void subtract_exact(enum subtract_mode mode, float x, float y, struct subtract_exact_s * ss);
-
 void subtract_gmp_ext(mpq_t op, bool d0, double x, bool d1, double y);
-void subtract_exact_ext(bool d0, float x, bool d1, float y, struct subtract_exact_s * ss);
 
-bool check_ddf_val(bool d, float q);
-bool compare_lte_ext(bool d0, float q0, bool d1, float q1);
+inline void subtract_exact(
+        enum subtract_mode mode,
+        float x,
+        float y,
+        struct subtract_exact_s * ss
+        ) {
+
+    switch (mode) {
+
+        case SUB_0:
+            assert(y <= x);
+            assert(!((x == 1) && (y==0)));
+            break;
+
+        case SUB_1:
+            assert(!((x == .5) && (y == .5)));
+            assert(!((x == 0.) && (y == 0.)));
+            float xx = max(x, y);
+            float yy = min(x, y);
+            x = xx;
+            y = yy;
+            break;
+    }
+
+    union float_bits fields_x = {.f = x};
+    union float_bits fields_y = {.f = y};
+
+    unsigned int e_x = fields_x.b.exponent;
+    unsigned int e_y = fields_y.b.exponent;
+
+    int32_t Emax = (1 << (FLT_SIZE_E - 1)) - 1;
+    int32_t ehat_x = e_x - Emax + (e_x == 0);
+    int32_t ehat_y = e_y - Emax + (e_y == 0);
+
+    unsigned int m_x = fields_x.b.mantissa;
+    unsigned int m_y = fields_y.b.mantissa;
+    int32_t f_x = m_x + ((int32_t)(e_x > 0) << FLT_SIZE_M);
+    int32_t f_y = m_y + ((int32_t)(e_y > 0) << FLT_SIZE_M);
+
+    int32_t f_hi = f_y >> min(ehat_x - ehat_y, FLT_SIZE_S + FLT_SIZE_E + FLT_SIZE_M - 1);
+    int32_t f_lo = f_y & ((1 << min(ehat_x - ehat_y, FLT_SIZE_M+1)) - 1);
+
+    switch (mode) {
+
+        case SUB_0:
+            ss->n_1 = -ehat_x - 1 + (x == 1);
+            ss->n_2 = max((ehat_x - ehat_y) - (FLT_SIZE_M + 1), 0);
+            ss->n_hi = FLT_SIZE_M + 1 - (x == 1);
+            ss->n_lo = min(ehat_x - ehat_y , FLT_SIZE_M + 1);
+            ss->b_1 = 0;
+            ss->b_2 = f_lo > 0;
+            ss->g_hi = f_x - f_hi - ss->b_2;
+            ss->g_lo = (ss->b_2 << ss->n_lo) - f_lo;
+            break;
+
+        case SUB_1:
+            ss->n_1 = -ehat_x - 2 + (x == .5);
+            ss->n_2 = max((ehat_x - ehat_y) - (FLT_SIZE_M + 1), 0);
+            ss->n_hi = FLT_SIZE_M + 2 - (x == .5);
+            ss->n_lo = min(ehat_x - ehat_y , FLT_SIZE_M + 1);
+            ss->b_1 = 1;
+            ss->b_2 = f_lo > 0;
+            ss->g_hi = (1 << ss->n_hi) - f_x - f_hi - ss->b_2;
+            ss->g_lo = (ss->b_2 << ss->n_lo) - f_lo;
+    }
+}
+
+inline void subtract_exact_ext(bool d0, float x, bool d1, float y, struct subtract_exact_s * ss){
+    if          ((d0 == 0) && (d1 == 0)) {subtract_exact(SUB_0, x, y, ss);}
+    else if     ((d0 == 1) && (d1 == 1)) {subtract_exact(SUB_0, y, x, ss);}
+    else if     ((d0 == 1) && (d1 == 0)) {subtract_exact(SUB_1, x, y, ss);}
+    else                                 {exit(EXIT_FAILURE);}
+}
+
+// Compute exact subtraction of doubles x - y (SUB_0) or 1 - (x+y) (SUB_1).
+void subtract_exact64(enum subtract_mode mode, double x, double y, struct subtract_exact64_s * ss);
+void subtract_exact64_ext(bool d0, double x, bool d1, double y, struct subtract_exact64_s * ss);
+
+// Fixed-point integers w[0] + w[1] 2^64 + w[2] 2^128, in units of 2^-149,
+// which represent every float in [0, 1] and every difference of two such
+// floats exactly.
+#define FIX_BITS 150
+#define FIX_WORDS 3
+typedef uint64_t fix_t[FIX_WORDS];
+
+// Convert f in [0, 1] to a fixed-point integer, clamping NaN and values
+// above 1 to 1, and negative values to 0.
+void fix_from_float(float f, fix_t w);
+void fix_from_ddf(bool d, float q, fix_t w);
+void fix_sub(const fix_t x, const fix_t y, fix_t z);
+void fix_shl1(fix_t w);
+int fix_cmp(const fix_t x, const fix_t y);
+bool fix_bit(const fix_t w, unsigned int i);
+bool fix_zero(const fix_t w);
+unsigned int fix_ctz(const fix_t w);
+void fix_shr(fix_t w, unsigned int k);
+double fix_to_double(const fix_t w);
+
+inline bool check_ddf_val(bool d, float q) {
+    return
+        ((d == 0) && (0 <= q) && (q <= 0.5))
+        ||
+        ((d == 1) && (0 <= q) && (q < 0.5));
+}
+
+inline bool compare_lte_ext(bool d0, float q0, bool d1, float q1) {
+    assert(check_ddf_val(d0, q0));
+    assert(check_ddf_val(d1, q1));
+    return (d0 < d1)
+            || ((d0 == 0) && (d1 == 0) && (q0 <= q1))
+            || ((d0 == 1) && (d1 == 1) && (q1 <= q0));
+}
+
+
+bool check_ddf64_val(bool d, double q);
+bool compare_lte_ext64(bool d0, double q0, bool d1, double q1);
 
 #endif
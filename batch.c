@@ -0,0 +1,219 @@
+/*
+  Name:     batch.c
+  Purpose:  Generate many random variates in lock step.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bits.h"
+#include "flip.h"
+#include "arithmetic.h"
+#include "generate.h"
+#include "batch.h"
+
+// All n traversals of the lex tree advance one level at a time. The
+// traversals are kept ordered by their current node b, so those at the
+// same node form a contiguous group that shares the midpoint, the CDF
+// values at both endpoints, and the exact masses of both children. The
+// target is evaluated once per group, and each group is split stably into
+// its children b+'0' and b+'1' for the next level. Each traversal keeps its
+// own depth `ell` and resolves each split exactly as in `generate_opt`.
+
+struct batch_group {
+    uint64_t b;             // Current bit string (lex order).
+    size_t start;           // Position of the first traversal in the order.
+    size_t size;            // Number of traversals at node b.
+    bool d_l; float cdf_l;  // CDF(b0^m)
+    bool d_r; float cdf_r;  // CDF(b1^m)
+};
+
+// Bytes of scratch space per traversal, which is allocated at once and
+// split into the arrays below in order of decreasing alignment.
+#define BATCH_BYTES (2 * sizeof(struct batch_group) + 2 * sizeof(size_t) \
+    + sizeof(double) + sizeof(unsigned int) + sizeof(float)             \
+    + sizeof(bool) + sizeof(unsigned char))
+
+// Take an array of `n` objects of `size` bytes from the scratch space at `p`.
+static void * batch_take(char ** p, size_t n, size_t size) {
+    void * a = *p;
+    *p += n * size;
+    return a;
+}
+
+// Adapters of the batched targets without a context to those with one.
+static void cdf_batch_plain(const double * x, const void * ctx, float * out, size_t m) {
+    (*(const cdf32_batch_t *) ctx)(x, out, m);
+}
+
+static void ddf_batch_plain(const double * x, const void * ctx, bool * b, float * p,
+        size_t m) {
+    (*(const ddf32_batch_t *) ctx)(x, b, p, m);
+}
+
+static int generate_opt_n_common(
+        cdf32_batch_ctx_t cdf
+        , ddf32_batch_ctx_t ddf
+        , const void * ctx
+        , struct flip_state * prng
+        , double * out
+        , size_t n
+        ) {
+
+    if (n == 0) { return 0; }
+    bool ext = (cdf == NULL);
+
+    if (SIZE_MAX / BATCH_BYTES < n) { return -1; }
+    char * scratch = malloc(n * BATCH_BYTES);
+    if (scratch == NULL) { return -1; }
+    char * p = scratch;
+    // Per-group state.
+    struct batch_group * groups = batch_take(&p, n, sizeof(struct batch_group));
+    struct batch_group * groups_next = batch_take(&p, n, sizeof(struct batch_group));
+    // Per-traversal state.
+    size_t * order = batch_take(&p, n, sizeof(size_t));
+    size_t * order_next = batch_take(&p, n, sizeof(size_t));
+    double * x = batch_take(&p, n, sizeof(double));
+    unsigned int * ell = batch_take(&p, n, sizeof(unsigned int));
+    float * cdf_m = batch_take(&p, n, sizeof(float));
+    bool * d_m = batch_take(&p, n, sizeof(bool));
+    unsigned char * z = batch_take(&p, n, sizeof(unsigned char));
+
+    for (size_t i = 0; i < n; i++) {
+        order[i] = i;
+        ell[i] = 0;
+    }
+    groups[0] = (struct batch_group){
+        .b = 0, .start = 0, .size = n,
+        .d_l = 0, .cdf_l = 0,
+        .d_r = ext, .cdf_r = ext ? 0 : 1,
+    };
+    size_t num_groups = 1;
+
+    RVG_STATS_BEGIN(prng);
+
+    for (int l = 0; l < DBL_SIZE; l++) {
+
+        // Compute CDF at midpoint of each group.
+        unsigned int m = DBL_SIZE - (l + 1);             // m = n_max - (len(b)+1)
+        for (size_t g = 0; g < num_groups; g++) {
+            uint64_t b_lex = (groups[g].b << (m + 1)) + (1ull << m) - 1; // b+'0' + '1'*m
+            x[g] = int2double(bij64_lex2float(b_lex));
+        }
+        if (ext) {
+            ddf(x, ctx, d_m, cdf_m, num_groups);
+        } else {
+            cdf(x, ctx, cdf_m, num_groups);
+            for (size_t g = 0; g < num_groups; g++) { d_m[g] = 0; }
+        }
+        RVG_STATS_ADD(cdf_calls, num_groups);
+
+        size_t num_groups_next = 0;
+        for (size_t g = 0; g < num_groups; g++) {
+            struct batch_group * group = &groups[g];
+            #ifndef NDEBUG
+            if (ext) {
+                assert(compare_lte_ext(group->d_l, group->cdf_l, d_m[g], cdf_m[g]));
+                assert(compare_lte_ext(d_m[g], cdf_m[g], group->d_r, group->cdf_r));
+            } else {
+                assert(group->cdf_l <= cdf_m[g]);
+                assert(cdf_m[g] <= group->cdf_r);
+            }
+            #endif
+
+            // Choose the next bit of each traversal.
+            size_t size_0 = 0;
+            if ((d_m[g] == group->d_r) && (cdf_m[g] == group->cdf_r)) {
+                // Trivial case.
+                size_0 = group->size;
+                for (size_t k = group->start; k < group->start + group->size; k++) {
+                    z[k] = 0;
+                    RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, ell[order[k]]);
+                }
+            } else if ((d_m[g] == group->d_l) && (cdf_m[g] == group->cdf_l)) {
+                // Trivial case.
+                for (size_t k = group->start; k < group->start + group->size; k++) {
+                    z[k] = 1;
+                    RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, ell[order[k]]);
+                }
+            } else {
+                // Finite arithmetic case.
+                struct subtract_exact_s ss0, ss1;
+                if (ext) {
+                    subtract_exact_ext(d_m[g], cdf_m[g], group->d_l, group->cdf_l, &ss0);
+                    subtract_exact_ext(group->d_r, group->cdf_r, d_m[g], cdf_m[g], &ss1);
+                } else {
+                    subtract_exact(SUB_0, cdf_m[g], group->cdf_l, &ss0);
+                    subtract_exact(SUB_0, group->cdf_r, cdf_m[g], &ss1);
+                }
+                for (size_t k = group->start; k < group->start + group->size; k++) {
+                    z[k] = generate_opt_split(&ss0, &ss1, &ell[order[k]], prng);
+                    RVG_STATS_LEVEL(RVG_TRACE_SPLIT, l, ell[order[k]]);
+                    size_0 += (z[k] == 0);
+                }
+            }
+
+            // Split the group stably into b+'0' and b+'1'.
+            size_t pos_0 = group->start;
+            size_t pos_1 = group->start + size_0;
+            for (size_t k = group->start; k < group->start + group->size; k++) {
+                order_next[z[k] ? pos_1++ : pos_0++] = order[k];
+            }
+            if (0 < size_0) {
+                groups_next[num_groups_next++] = (struct batch_group){
+                    .b = group->b << 1, .start = group->start, .size = size_0,
+                    .d_l = group->d_l, .cdf_l = group->cdf_l,
+                    .d_r = d_m[g], .cdf_r = cdf_m[g],
+                };
+            }
+            if (size_0 < group->size) {
+                groups_next[num_groups_next++] = (struct batch_group){
+                    .b = (group->b << 1) | 1, .start = group->start + size_0,
+                    .size = group->size - size_0,
+                    .d_l = d_m[g], .cdf_l = cdf_m[g],
+                    .d_r = group->d_r, .cdf_r = group->cdf_r,
+                };
+            }
+        }
+
+        size_t * order_tmp = order; order = order_next; order_next = order_tmp;
+        struct batch_group * groups_tmp = groups; groups = groups_next; groups_next = groups_tmp;
+        num_groups = num_groups_next;
+    }
+
+    // Record the variates together, since the traversals share the flips.
+    RVG_STATS_ADD(samples, n);
+    RVG_STATS_ADD(flips, prng->num_flips - rvg_stats_flips__);
+
+    // Write the results.
+    for (size_t g = 0; g < num_groups; g++) {
+        double result = int2double(bij64_lex2float(groups[g].b));
+        for (size_t k = groups[g].start; k < groups[g].start + groups[g].size; k++) {
+            out[order[k]] = result;
+        }
+    }
+
+    free(scratch);
+    return 0;
+}
+
+int generate_opt_n(cdf32_batch_t cdf, struct flip_state * prng, double * out, size_t n) {
+    return generate_opt_n_common(cdf_batch_plain, NULL, &cdf, prng, out, n);
+}
+
+int generate_opt_n_ext(ddf32_batch_t ddf, struct flip_state * prng, double * out, size_t n) {
+    return generate_opt_n_common(NULL, ddf_batch_plain, &ddf, prng, out, n);
+}
+
+int generate_opt_n_ctx(cdf32_batch_ctx_t cdf, const void * ctx, struct flip_state * prng,
+        double * out, size_t n) {
+    return generate_opt_n_common(cdf, NULL, ctx, prng, out, n);
+}
+
+int generate_opt_n_ext_ctx(ddf32_batch_ctx_t ddf, const void * ctx, struct flip_state * prng,
+        double * out, size_t n) {
+    return generate_opt_n_common(NULL, ddf, ctx, prng, out, n);
+}
@@ -0,0 +1,47 @@
+/*
+  Name:     batch.h
+  Purpose:  Generate many random variates in lock step.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "flip.h"
+
+// Batched 32-bit cumulative distribution function, which sets
+// out[i] = Pr(X <= x[i]) for 0 <= i < m.
+typedef void (*cdf32_batch_t)(const double * x, float * out, size_t m);
+
+// Batched 32-bit dual distribution function, which sets b[i] and p[i]
+// to the result of the DDF at x[i] for 0 <= i < m.
+typedef void (*ddf32_batch_t)(const double * x, bool * b, float * p, size_t m);
+
+// As cdf32_batch_t and ddf32_batch_t, with a context `ctx` that is passed
+// unchanged to every call, as cdf32_ctx_t and ddf32_ctx_t.
+typedef void (*cdf32_batch_ctx_t)(const double * x, const void * ctx, float * out, size_t m);
+typedef void (*ddf32_batch_ctx_t)(const double * x, const void * ctx, bool * b, float * p,
+    size_t m);
+
+/** Generate `n` random variables optimally from `cdf` into `out`. Returns 0,
+    or -1 if the scratch space of the traversals cannot be allocated, in
+    which case `out` and `prng` are unchanged. */
+int generate_opt_n(cdf32_batch_t cdf, struct flip_state * prng, double * out, size_t n);
+
+/** Generate `n` random variables optimally from `ddf` into `out`, with the
+    same errors as `generate_opt_n`. */
+int generate_opt_n_ext(ddf32_batch_t ddf, struct flip_state * prng, double * out, size_t n);
+
+/** Generate `n` random variables optimally from `cdf` with context `ctx` into `out`. */
+int generate_opt_n_ctx(cdf32_batch_ctx_t cdf, const void * ctx, struct flip_state * prng,
+    double * out, size_t n);
+
+/** Generate `n` random variables optimally from `ddf` with context `ctx` into `out`. */
+int generate_opt_n_ext_ctx(ddf32_batch_ctx_t ddf, const void * ctx, struct flip_state * prng,
+    double * out, size_t n);
+
+#endif
@@ -0,0 +1,299 @@
+/*
+  Name:     bench.c
+  Purpose:  Benchmark the generators against the native samplers of the GSL.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gsl/gsl_cdf.h>
+#include <gsl/gsl_randist.h>
+#include <gsl/gsl_rng.h>
+
+#include "rvg/flip.h"
+#include "rvg/generate.h"
+#include "rvg/prng.h"
+
+// Usage: bench.out [num_samples]
+//
+// For every generator, distribution, and method, prints one CSV row with the
+// throughput (from one timed loop of num_samples variates), the latency
+// percentiles (from BENCH_LATENCY variates timed one at a time, including
+// the overhead of the clock), and the number of evaluations of the target
+// and of random bits per variate (from a separate pass through counting
+// wrappers, so that the timed loops call the target directly). The native
+// samplers of the GSL consume whole words, whose bits are all counted.
+
+// Default number of variates in the timed loop.
+#define BENCH_SAMPLES 100000
+
+// Number of variates timed one at a time.
+#define BENCH_LATENCY 10000
+
+// Seed of every generator, which is reset before each row.
+#define BENCH_SEED 0x2545f491
+
+enum bench_method {BENCH_OPT, BENCH_OPT_EXT, BENCH_CBS, BENCH_CBS_EXT, BENCH_GSL};
+
+static const char * bench_method_name[] = {"opt", "opt_ext", "cbs", "cbs_ext", "gsl"};
+
+// A target distribution, where `sf` and `native` are NULL if absent. The
+// `ddf` of `cdf` and `sf` is made by rvg_ddf_make with the target as context.
+struct bench_dist {
+    const char * name;
+    cdf32_t cdf;
+    cdf32_t sf;
+    double (*native)(const gsl_rng * rng);
+    struct rvg_ddf ddf;
+};
+
+static float bench_dist_cdf(double x, const void * ctx) {
+    return ((const struct bench_dist *) ctx)->cdf(x);
+}
+
+static float bench_dist_sf(double x, const void * ctx) {
+    return ((const struct bench_dist *) ctx)->sf(x);
+}
+
+// ================ Distributions ================
+
+// Distributions from the GSL (continuous).
+MAKE_CDF_P(gaussian_cdf, gsl_cdf_gaussian_P, 1)
+MAKE_CDF_Q(gaussian_sf, gsl_cdf_gaussian_Q, 1)
+
+MAKE_CDF_P(exponential_cdf, gsl_cdf_exponential_P, 1)
+MAKE_CDF_Q(exponential_sf, gsl_cdf_exponential_Q, 1)
+
+MAKE_CDF_P(cauchy_cdf, gsl_cdf_cauchy_P, 1)
+MAKE_CDF_Q(cauchy_sf, gsl_cdf_cauchy_Q, 1)
+
+// Distributions from the GSL (discrete).
+MAKE_CDF_UINT_P(poisson_cdf, gsl_cdf_poisson_P, 5)
+MAKE_CDF_UINT_Q(poisson_sf, gsl_cdf_poisson_Q, 5)
+
+MAKE_CDF_UINT_P(binomial_cdf, gsl_cdf_binomial_P, 0.3, 100)
+MAKE_CDF_UINT_Q(binomial_sf, gsl_cdf_binomial_Q, 0.3, 100)
+
+MAKE_CDF_UINT_P(geometric_cdf, gsl_cdf_geometric_P, 0.2)
+MAKE_CDF_UINT_Q(geometric_sf, gsl_cdf_geometric_Q, 0.2)
+
+// A point mass at +0.0.
+static float point_cdf(double x) {
+    if (x != x)             { return 1; }
+    return signbit(x) ? 0 : 1;
+}
+static float point_sf(double x) {
+    if (x != x)             { return 0; }
+    return signbit(x) ? 1 : 0;
+}
+
+// A point mass at NaN, which has no DDF (see rvg_ddf_make).
+static float nan_cdf(double x) {
+    return (x != x) ? 1. : 0.;
+}
+
+// A uniform distribution over [0, 2^-1060], i.e., over subnormals.
+static float subnormal_cdf(double x) {
+    if (x != x)             { return 1; }
+    else if (signbit(x))    { return 0; }
+    else if (0x1p-1060 <= x) { return 1; }
+    else                    { return ldexp(x, 1060); }
+}
+static float subnormal_sf(double x) {
+    if (x != x)             { return 0; }
+    else if (signbit(x))    { return 1; }
+    else if (0x1p-1060 <= x) { return 0; }
+    else                    { return 1 - ldexp(x, 1060); }
+}
+
+// ================ Native Samplers ================
+
+static double native_gaussian(const gsl_rng * rng) { return gsl_ran_gaussian(rng, 1); }
+static double native_exponential(const gsl_rng * rng) { return gsl_ran_exponential(rng, 1); }
+static double native_cauchy(const gsl_rng * rng) { return gsl_ran_cauchy(rng, 1); }
+static double native_poisson(const gsl_rng * rng) { return gsl_ran_poisson(rng, 5); }
+static double native_binomial(const gsl_rng * rng) { return gsl_ran_binomial(rng, 0.3, 100); }
+static double native_geometric(const gsl_rng * rng) { return gsl_ran_geometric(rng, 0.2); }
+
+// ================ Counting Wrappers ================
+
+static cdf32_t count_cdf_target;
+static unsigned long count_calls;
+
+static float count_cdf(double x) {
+    count_calls++;
+    return count_cdf_target(x);
+}
+
+static void count_ddf(double x, const void * ddf, bool * d, float * q) {
+    count_calls++;
+    rvg_ddf_eval(x, ddf, d, q);
+}
+
+// A gsl_rng that counts the words drawn from another gsl_rng.
+typedef struct {
+    gsl_rng * inner;
+    unsigned long calls;
+} count_rng_state_t;
+
+static unsigned long int count_rng_get(void * vstate) {
+    count_rng_state_t * state = vstate;
+    state->calls++;
+    return gsl_rng_get(state->inner);
+}
+
+static double count_rng_get_double(void * vstate) {
+    count_rng_state_t * state = vstate;
+    state->calls++;
+    return gsl_rng_uniform(state->inner);
+}
+
+static void count_rng_set(void * vstate, unsigned long int s) {
+    return;
+}
+
+static gsl_rng_type count_rng_type = {
+    "count",
+    0,
+    0,
+    sizeof(count_rng_state_t),
+    &count_rng_set,
+    &count_rng_get,
+    &count_rng_get_double
+};
+
+// ================ Timing ================
+
+static inline uint64_t now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ull + (uint64_t) t.tv_nsec;
+}
+
+static int compare_u64(const void * a, const void * b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static inline double draw(enum bench_method method, cdf32_t cdf, ddf32_ctx_t ddf,
+        const struct bench_dist * dist, struct flip_state * prng, const gsl_rng * rng) {
+    switch (method) {
+        case BENCH_OPT:     return generate_opt(cdf, prng);
+        case BENCH_OPT_EXT: return generate_opt_ext_ctx(ddf, &dist->ddf, prng);
+        case BENCH_CBS:     return generate_cbs(cdf, prng);
+        case BENCH_CBS_EXT: return generate_cbs_ext_ctx(ddf, &dist->ddf, prng);
+        case BENCH_GSL:     return dist->native(rng);
+    }
+    abort();
+}
+
+// Print the row of `method` on `dist`, drawing from a `rng` of type `T`.
+static void bench_row(const gsl_rng_type * T, const struct bench_dist * dist,
+        enum bench_method method, size_t n) {
+    volatile double sink;
+    gsl_rng * rng = gsl_rng_alloc(T);
+
+    // Throughput.
+    gsl_rng_set(rng, BENCH_SEED);
+    struct flip_state prng = make_flip_state(rng);
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        sink = draw(method, dist->cdf, rvg_ddf_eval, dist, &prng, rng);
+    }
+    double ns = (double) (now_ns() - t0) / n;
+
+    // Latency.
+    size_t n_lat = (n < BENCH_LATENCY) ? n : BENCH_LATENCY;
+    uint64_t * lat = malloc(n_lat * sizeof(*lat));
+    for (size_t i = 0; i < n_lat; i++) {
+        uint64_t t = now_ns();
+        sink = draw(method, dist->cdf, rvg_ddf_eval, dist, &prng, rng);
+        lat[i] = now_ns() - t;
+    }
+    qsort(lat, n_lat, sizeof(*lat), compare_u64);
+
+    // Evaluations of the target and random bits.
+    gsl_rng_set(rng, BENCH_SEED);
+    count_cdf_target = dist->cdf;
+    count_calls = 0;
+    count_rng_type.max = gsl_rng_max(rng);
+    count_rng_type.min = gsl_rng_min(rng);
+    gsl_rng * crng = gsl_rng_alloc(&count_rng_type);
+    count_rng_state_t * cstate = crng->state;
+    cstate->inner = rng;
+    cstate->calls = 0;
+    struct flip_state cprng = make_flip_state(rng);
+    for (size_t i = 0; i < n_lat; i++) {
+        sink = draw(method, count_cdf, count_ddf, dist, &cprng, crng);
+    }
+    double bits = (method == BENCH_GSL)
+        ? (double) cstate->calls * gsl_rng_buffer_size(rng) / n_lat
+        : (double) cprng.num_flips / n_lat;
+    (void) sink;
+
+    printf("%s,%s,%s,%zu,%.2f,%.0f,%lu,%lu,%lu,",
+        gsl_rng_name(rng), dist->name, bench_method_name[method], n,
+        ns, 1e9 / ns,
+        (unsigned long) lat[n_lat / 2],
+        (unsigned long) lat[(n_lat * 9) / 10],
+        (unsigned long) lat[(n_lat * 99) / 100]);
+    if (method == BENCH_GSL) {
+        printf(",%.2f\n", bits);
+    } else {
+        printf("%.2f,%.2f\n", (double) count_calls / n_lat, bits);
+    }
+    fflush(stdout);
+
+    free(lat);
+    gsl_rng_free(crng);
+    gsl_rng_free(rng);
+}
+
+int main(int argc, char * argv[]) {
+
+    size_t n = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_SAMPLES;
+
+    struct bench_dist dists[] = {
+        {"gaussian",    gaussian_cdf,       gaussian_sf,        native_gaussian},
+        {"exponential", exponential_cdf,    exponential_sf,     native_exponential},
+        {"cauchy",      cauchy_cdf,         cauchy_sf,          native_cauchy},
+        {"poisson",     poisson_cdf,        poisson_sf,         native_poisson},
+        {"binomial",    binomial_cdf,       binomial_sf,        native_binomial},
+        {"geometric",   geometric_cdf,      geometric_sf,       native_geometric},
+        {"point",       point_cdf,          point_sf,           NULL},
+        {"nan",         nan_cdf,            NULL,               NULL},
+        {"subnormal",   subnormal_cdf,      subnormal_sf,       NULL},
+    };
+    for (size_t i = 0; i < sizeof(dists) / sizeof(*dists); i++) {
+        if ((dists[i].sf != NULL) && (rvg_ddf_make(&dists[i].ddf,
+                bench_dist_cdf, bench_dist_sf, &dists[i]) != 0)) {
+            fprintf(stderr, "Invalid DDF of %s.\n", dists[i].name);
+            return 1;
+        }
+    }
+
+    // The native samplers reject on a constant stream, and never terminate
+    // on a gsl_rng_deterministic, so they run on the default generator only.
+    const gsl_rng_type * rngs[] = {gsl_rng_default, gsl_rng_deterministic};
+
+    printf("rng,distribution,method,samples,ns_per_sample,samples_per_sec,"
+        "p50_ns,p90_ns,p99_ns,cdf_calls_per_sample,bits_per_sample\n");
+    for (size_t r = 0; r < sizeof(rngs) / sizeof(*rngs); r++) {
+        for (size_t i = 0; i < sizeof(dists) / sizeof(*dists); i++) {
+            for (int m = BENCH_OPT; m <= BENCH_GSL; m++) {
+                bool ext = (m == BENCH_OPT_EXT) || (m == BENCH_CBS_EXT);
+                if (ext && (dists[i].sf == NULL)) { continue; }
+                if ((m == BENCH_GSL) && ((dists[i].native == NULL)
+                        || (rngs[r] == gsl_rng_deterministic))) { continue; }
+                bench_row(rngs[r], &dists[i], m, n);
+            }
+        }
+    }
+}
@@ -7,47 +7,61 @@
 
 #include <assert.h>
 #include <math.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <gmp.h>
 
+#include "arithmetic.h"
 #include "bits.h"
 #include "flip.h"
 #include "bernoulli.h"
 
 // ================ bernoulli ================
 
+// Both functions below generate the binary expansion b_1 b_2 ... of k/n and
+// the flips f_1 f_2 ..., and return b_i at the first i with f_i = 1. If the
+// expansion terminates at b_t = 1 (i.e., the remainder becomes 0), then f_t
+// is returned instead. The flips are not drawn one at a time: the position
+// c of the first 1 among the buffered flips is found with ctz, the expansion
+// is advanced up to that position (stopping early if it terminates), and
+// only then are the flips consumed, so that exactly the same flips are used.
+// The expected number of flips is 2, so the expansion is advanced a bit at
+// a time rather than a block at a time by a multiword division.
+
 unsigned char bernoulli(uintmax_t k, uintmax_t n, struct flip_state * prng) {
     assert(k < n);
     if (k == 0) { assert(0); return 0; }
     if (k == n) { assert(0); return 1; }
 
-    #ifndef NDEBUG
-    uintmax_t j = k;
-    #endif
-
-    unsigned char b;
     while (1) {
-        k <<= 1;
-
-        if (k == n) {
-            return flip(prng);
+        unsigned int avail = flip_avail(prng);
+        unsigned long long window = prng->buffer & (ULLONG_MAX >> (FLIP_ULLONG_BIT - avail));
+        unsigned int c = (window == 0) ? avail : (unsigned int) __builtin_ctzll(window);
+        // If k * 2^(c+1) fits in a word, then b_{c+1} is obtained directly
+        // by one division, provided that the expansion has not terminated.
+        if ((c < avail) && (c < 62) && ((k >> (62 - c)) == 0)) {
+            uintmax_t x = k << (c + 1);
+            if (x % n != 0) {
+                flip_consume(prng, c + 1);
+                return (x / n) & 1;
+            }
         }
-        if (n <= k) {
-            k -= n;
-            b = 1;
-        } else {
-            b = 0;
-        }
-
-        #ifndef NDEBUG
-        j <<= 1;
-        j %= n;
-        assert(j == k);
-        #endif
-
-        if (flip(prng)) {
-            return b;
+        for (unsigned int i = 0; i <= c && i < avail; i++) {
+            // Next bit of the expansion, where 2k is compared without overflow.
+            uintmax_t d = n - k;
+            if (k == d) {
+                flip_consume(prng, i + 1);
+                return i == c;
+            }
+            unsigned char b = (d < k);
+            k = b ? k - d : k << 1;
+            if (i == c) {
+                flip_consume(prng, i + 1);
+                return b;
+            }
         }
+        flip_consume(prng, avail);
     }
 }
 
@@ -56,45 +70,82 @@ unsigned char bernoulli_gmp(mpz_t k, mpz_t n, struct flip_state * prng) {
     if (mpz_cmp_ui(k, 0) == 0)  { assert(0); return 0; }
     if (mpz_cmp(k, n) == 0)     { assert(0); return 1; }
 
-    #ifndef NDEBUG
-    mpz_t j; mpz_init(j); mpz_set(j, k);
-    #endif
-
-    unsigned char b;
     while (1) {
-        mpz_mul_2exp(k, k, 1); // k <<= 1
-
-        if (mpz_cmp(k, n) == 0) {
-             b = flip(prng);
-             break;
-        }
-        if (mpz_cmp(n, k) <= 0) {
-            mpz_sub(k, k, n);
-            b = 1;
-        } else {
-            b = 0;
+        unsigned int avail = flip_avail(prng);
+        unsigned long long window = prng->buffer & (ULLONG_MAX >> (FLIP_ULLONG_BIT - avail));
+        unsigned int c = (window == 0) ? avail : (unsigned int) __builtin_ctzll(window);
+        for (unsigned int i = 0; i <= c && i < avail; i++) {
+            mpz_mul_2exp(k, k, 1); // k <<= 1
+            int cmp = mpz_cmp(k, n);
+            if (cmp == 0) {
+                flip_consume(prng, i + 1);
+                return i == c;
+            }
+            unsigned char b = (0 < cmp);
+            if (b) {
+                mpz_sub(k, k, n);
+            }
+            if (i == c) {
+                flip_consume(prng, i + 1);
+                return b;
+            }
         }
+        flip_consume(prng, avail);
+    }
+}
 
-        #ifndef NDEBUG
-        mpz_mul_2exp(j, j, 1); // j <<= 1
-        mpz_mod(j, j, n);   // j %= n
-        assert(mpz_cmp(j, k) == 0);
-        #endif
+unsigned char bernoulli_fix(const fix_t k, const fix_t n, struct flip_state * prng) {
+    assert(fix_cmp(k, n) < 0);
+    assert(!fix_zero(k));
 
-        if (flip(prng)) {
-            break;
+    // Since n < 2^FIX_BITS, doubling a remainder below n does not overflow.
+    fix_t r = {k[0], k[1], k[2]};
+    while (1) {
+        unsigned int avail = flip_avail(prng);
+        unsigned long long window = prng->buffer & (ULLONG_MAX >> (FLIP_ULLONG_BIT - avail));
+        unsigned int c = (window == 0) ? avail : (unsigned int) __builtin_ctzll(window);
+        for (unsigned int i = 0; i <= c && i < avail; i++) {
+            fix_shl1(r);
+            int cmp = fix_cmp(r, n);
+            if (cmp == 0) {
+                flip_consume(prng, i + 1);
+                return i == c;
+            }
+            unsigned char b = (0 < cmp);
+            if (b) {
+                fix_sub(r, n, r);
+            }
+            if (i == c) {
+                flip_consume(prng, i + 1);
+                return b;
+            }
         }
+        flip_consume(prng, avail);
     }
-
-    #ifndef NDEBUG
-    mpz_clear(j);
-    #endif
-
-    return b;
 }
 
 // ================ sample_random_Em ================
 
+// Number of flips equal to 0 before the first 1, consuming the flips up to
+// and including that 1, or consuming `k` flips and returning `k` if they
+// are all 0. The zeros are counted a whole buffer at a time.
+static inline unsigned int flip_zeros(struct flip_state * prng, unsigned int k) {
+    unsigned int z = 0;
+    while (z < k) {
+        unsigned int n = flip_avail(prng);
+        if (k - z < n) { n = k - z; }
+        unsigned long long window = prng->buffer & (ULLONG_MAX >> (FLIP_ULLONG_BIT - n));
+        if (window != 0) {
+            unsigned int c = __builtin_ctzll(window);
+            flip_consume(prng, c + 1);
+            return z + c;
+        }
+        flip_consume(prng, n);
+        z += n;
+    }
+    return k;
+}
+
 static const union float_bits lo_Emf = {.f = 0.};
 static const union float_bits hi_Emf = {.f = 1.};
 
@@ -111,18 +162,9 @@ void sample_random_Emf(
     // Chose random bits and decrement exp until 1 appears.
     uint32_t exp_hi = hi_Emf.b.exponent - 1 - exp_offset;
     uint32_t exp_lo = lo_Emf.b.exponent;
-    for (exp = exp_hi; exp > exp_lo; exp--) {
-        if (flip(prng)) {
-            break;
-        }
-    }
+    exp = exp_hi - flip_zeros(prng, exp_hi - exp_lo);
     // Choose random 23-bit mantissa.
-    mant = 0;
-    for (int i = 0; i < FLT_SIZE_M; i++) {
-        uint32_t b = flip(prng);
-        mant = (b << i) | mant;
-        // mant = (mant << 1) | b;
-    }
+    mant = flip_bits(prng, FLT_SIZE_M);
     // Set the pointers.
     *p_exp = exp;
     *p_mant = mant;
@@ -145,18 +187,9 @@ void sample_random_Em(
     // Choose random bits and decrement exp until 1 appears.
     uint64_t exp_hi = hi_Em.b.exponent - 1 - exp_offset;
     uint64_t exp_lo = lo_Em.b.exponent;
-    for (exp = exp_hi; exp > exp_lo; exp--) {
-        if (flip(prng)) {
-            break;
-        }
-    }
+    exp = exp_hi - flip_zeros(prng, exp_hi - exp_lo);
     // Choose random 52-bit mantissa.
-    mant = 0;
-    for (int i = 0; i < DBL_SIZE_M; i++) {
-        uint64_t b = flip(prng);
-        mant = (b << i) | mant;
-        // mant = (mant << 1) | b;
-    }
+    mant = flip_bits(prng, DBL_SIZE_M);
     // Set the pointers.
     *p_exp = exp;
     *p_mant = mant;
@@ -192,6 +225,18 @@ double uniform(enum round_mode mode, struct flip_state * prng) {
     return (mode == RND_U) ? nextafter(ans.f, 1.) : ans.f;
 }
 
+void uniformf_n(enum round_mode mode, struct flip_state * prng, float * out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = uniformf(mode, prng);
+    }
+}
+
+void uniform_n(enum round_mode mode, struct flip_state * prng, double * out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = uniform(mode, prng);
+    }
+}
+
 // ================ uniform_ext ================
 
 void uniformf_ext(
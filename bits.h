@@ -8,8 +8,10 @@
 #ifndef BITS_H
 #define BITS_H
 
-#include <stdint.h>
+#include <assert.h>
 #include <limits.h>
+#include <math.h>
+#include <stdint.h>
 
 // TODO: Use #include <ieee754_double.h> instead.
 
@@ -47,26 +49,121 @@ union double_bits {
   } b;
 };
 
+// The conversions below are inline so that they compile to a few
+// instructions in the generators. Each external definition is in bits.c.
+
 // Convert floats to and from unsigned integers.
-uint32_t float2int(float f);
-float int2float(uint32_t i);
+inline uint32_t float2int(float f) {
+    return ((union float_bits){.f = f}).i;
+}
+
+inline float int2float(uint32_t i) {
+    return ((union float_bits){.i = i}).f;
+}
 
 // Convert doubles to and from unsigned integers.
-uint64_t double2int(double f);
-double int2double(uint64_t i);
+inline uint64_t double2int(double f) {
+    return ((union double_bits){.f = f}).i;
+}
+
+inline double int2double(uint64_t i) {
+    return ((union double_bits){.i = i}).f;
+}
 
 // Convert bit string in sign-magnitude system to lexicographic system.
-uint32_t bij32_sm2lex(uint32_t b);
-uint32_t bij32_lex2sm(uint32_t b);
+inline uint32_t bij32_sm2lex(uint32_t b) {
+    // size_t width = CHAR_BIT * sizeof(b);
+    // assert(width == 32);
+    unsigned char c = (b >> 31) & 1;
+    if (c == 0) {
+        // Flip MSB: 0x80000000 = 2^31
+        return b ^ 0x80000000;
+    } else {
+        return ~b;
+    }
+}
+
+inline uint32_t bij32_lex2sm(uint32_t b) {
+    // size_t width = CHAR_BIT * sizeof(b);
+    // assert(width == 32);
+    unsigned char c = (b >> 31) & 1;
+    if (c == 0) {
+        return ~b;
+    } else {
+        // Flip MSB: 0x80000000 = 2^31
+        return b ^ 0x80000000;
+    }
+}
+
 // Convert bit string in float system to lexicographic system.
-uint32_t bij32_float2lex(uint32_t b);
-uint32_t bij32_lex2float(uint32_t b);
+inline uint32_t bij32_lex2float(uint32_t b) {
+    // 0xFF800000 = 1 1^E 0^m
+    if (b <= 0xFF800000) {
+        // 0x007FFFFF = 2^m - 1
+        return bij32_lex2sm(b + 0x007FFFFF);
+    } else {
+        assert(isnan(int2float(b)));
+        return b;
+    }
+}
+
+inline uint32_t bij32_float2lex(uint32_t b) {
+    // 0xFF800000 = 1 1^E 0^m
+    if (b <= 0xFF800000) {
+        // 0x007FFFFF = 2^m - 1
+        return bij32_sm2lex(b) - 0x007FFFFF;
+    } else {
+        assert(isnan(int2float(b)));
+        return b;
+    }
+}
 
 // Convert bit string in sign-magnitude system to lexicographic system.
-uint64_t bij64_sm2lex(uint64_t b);
-uint64_t bij64_lex2sm(uint64_t b);
+inline uint64_t bij64_sm2lex(uint64_t b) {
+    // size_t width = CHAR_BIT * sizeof(b);
+    // assert(width == 64);
+    unsigned char c = (b >> 63) & 1;
+    if (c == 0) {
+        // Flip MSB: 0x8000000000000000 = 2^63
+        return b ^ 0x8000000000000000;
+    } else {
+        return ~b;
+    }
+}
+
+inline uint64_t bij64_lex2sm(uint64_t b) {
+    // size_t width = CHAR_BIT * sizeof(b);
+    // assert(width == 64);
+    unsigned char c = (b >> 63) & 1;
+    if (c == 0) {
+        return ~b;
+    } else {
+        // Flip MSB: 0x8000000000000000 = 2^63
+        return b ^ 0x8000000000000000;
+    }
+}
+
 // Convert bit string in float system to lexicographic system.
-uint64_t bij64_float2lex(uint64_t b);
-uint64_t bij64_lex2float(uint64_t b);
+inline uint64_t bij64_lex2float(uint64_t b) {
+    // 0xFFF0000000000000 = 1 1^E 0^m
+    if (b <= 0xFFF0000000000000) {
+        // 0x000FFFFFFFFFFFFF = 2^m - 1
+        return bij64_lex2sm(b + 0x000FFFFFFFFFFFFF);
+    } else {
+        assert(isnan(int2double(b)));
+        return b;
+    }
+}
+
+inline uint64_t bij64_float2lex(uint64_t b) {
+    // 0xFFF0000000000000 = 1 1^E 0^m
+    if (b <= 0xFFF0000000000000) {
+        // 0x000FFFFFFFFFFFFF = 2^m - 1, where m = 52 mantissa bits.
+        return bij64_sm2lex(b) - 0x000FFFFFFFFFFFFF;
+    } else {
+        assert(isnan(int2double(b)));
+        return b;
+    }
+}
 
 #endif
@@ -0,0 +1,450 @@
+/*
+  Name:     check.c
+  Purpose:  Check the kernels of dist.h and the generators.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <gsl/gsl_rng.h>
+
+#include "rvg/arithmetic.h"
+#include "rvg/batch.h"
+#include "rvg/discrete.h"
+#include "rvg/dist.h"
+#include "rvg/flip.h"
+#include "rvg/generate.h"
+#include "rvg/pool.h"
+#include "rvg/prng.h"
+#include "rvg/sampler.h"
+#include "rvg/table.h"
+
+// Usage: check.out
+//
+// The special functions of dist.c switch between a series and a continued
+// fraction at a point that depends on the parameters, where rounding errors
+// of the two methods differ. For each parameter in a grid, this program
+// sweeps the adjacent doubles on either side of the switch (and the integers
+// of the discrete distributions across it), and checks that the CDF is
+// nondecreasing, the SF is nonincreasing, and the DDF is nondecreasing in
+// the order of compare_lte_ext. It then checks the generators on edge
+// cases of their arguments, that the sampler, table, and batch generators
+// return the same variates and consume the same flips as generate_opt,
+// that a compiled discrete distribution is exact and entropy-optimal, that
+// the output of a pool does not depend on its number of threads, and that
+// Philox4x32-10 gives the known-answer vectors of Random123.
+// Prints each violation and exits with a nonzero status if there is any.
+
+// Number of adjacent doubles swept on either side of a switch point.
+#define CHECK_SWEEP 4096
+
+// Number of variates compared with those of generate_opt.
+#define CHECK_DRAWS 10000
+
+// Seed of the generators compared with generate_opt.
+#define CHECK_SEED 1234
+
+// Path of the table written by check_table.
+#define CHECK_TABLE_PATH "check.rvg"
+
+// Number of violations.
+static unsigned long check_failures = 0;
+
+// State of a sweep through increasing x.
+struct check_sweep {
+    const char * name;      // Name of the distribution and its parameters.
+    bool first;             // Whether no x has been checked yet.
+    double x;               // Previous x.
+    float p;                // CDF at the previous x.
+    float q;                // SF at the previous x.
+    bool d;                 // DDF direction at the previous x.
+    float r;                // DDF value at the previous x.
+};
+
+static void check_sweep_init(struct check_sweep * s, const char * name) {
+    s->name = name;
+    s->first = true;
+}
+
+// Check the values at x, which is larger than the previous x.
+static void check_sweep_step(struct check_sweep * s, double x, float p, float q,
+        bool d, float r) {
+    if (!s->first) {
+        if ((p < s->p) || (s->q < q) || !compare_lte_ext(s->d, s->r, d, r)) {
+            printf("%s: x = %a (%.17g): P %a -> %a, Q %a -> %a, D (%d, %a) -> (%d, %a)\n",
+                s->name, x, x, s->p, p, s->q, q, s->d, s->r, d, r);
+            check_failures++;
+        }
+    }
+    s->first = false;
+    s->x = x;
+    s->p = p;
+    s->q = q;
+    s->d = d;
+    s->r = r;
+}
+
+// Sweep the doubles around x0 for the gamma distribution with shape a.
+static void check_gamma(double a, double x0) {
+    char name[128];
+    snprintf(name, sizeof(name), "gamma(%.17g, 1)", a);
+    struct check_sweep s;
+    check_sweep_init(&s, name);
+    double x = x0;
+    for (int i = 0; i < CHECK_SWEEP; i++) { x = nextafter(x, -INFINITY); }
+    for (int i = 0; i < 2 * CHECK_SWEEP; i++) {
+        bool d; float r;
+        dist_gamma_D(x, &d, &r, a, 1);
+        check_sweep_step(&s, x, dist_gamma_P(x, a, 1), dist_gamma_Q(x, a, 1), d, r);
+        x = nextafter(x, INFINITY);
+    }
+}
+
+// Sweep the doubles around x0 for the beta distribution with shapes a, b.
+static void check_beta(double a, double b, double x0) {
+    char name[128];
+    snprintf(name, sizeof(name), "beta(%.17g, %.17g)", a, b);
+    struct check_sweep s;
+    check_sweep_init(&s, name);
+    double x = x0;
+    for (int i = 0; i < CHECK_SWEEP; i++) { x = nextafter(x, -INFINITY); }
+    for (int i = 0; i < 2 * CHECK_SWEEP; i++) {
+        bool d; float r;
+        dist_beta_D(x, &d, &r, a, b);
+        check_sweep_step(&s, x, dist_beta_P(x, a, b), dist_beta_Q(x, a, b), d, r);
+        x = nextafter(x, INFINITY);
+    }
+}
+
+// Sweep the integers [0, k1] for the Poisson distribution with mean mu.
+static void check_poisson(double mu, double k1) {
+    char name[128];
+    snprintf(name, sizeof(name), "poisson(%.17g)", mu);
+    struct check_sweep s;
+    check_sweep_init(&s, name);
+    for (double k = 0; k <= k1; k++) {
+        bool d; float r;
+        dist_poisson_D(k, &d, &r, mu);
+        check_sweep_step(&s, k, dist_poisson_P(k, mu), dist_poisson_Q(k, mu), d, r);
+    }
+}
+
+// Sweep the integers [0, n] for the binomial distribution.
+static void check_binomial(double pp, unsigned int n) {
+    char name[128];
+    snprintf(name, sizeof(name), "binomial(%.17g, %u)", pp, n);
+    struct check_sweep s;
+    check_sweep_init(&s, name);
+    for (unsigned int k = 0; k <= n; k++) {
+        bool d; float r;
+        dist_binomial_D(k, &d, &r, pp, n);
+        check_sweep_step(&s, k, dist_binomial_P(k, pp, n), dist_binomial_Q(k, pp, n), d, r);
+    }
+}
+
+// ================ Generators ================
+
+// Report a violation named `name` unless `ok`.
+static void check_true(bool ok, const char * name) {
+    if (!ok) {
+        printf("%s: failed\n", name);
+        check_failures++;
+    }
+}
+
+// A point mass at +0.0.
+static float check_point_cdf(double x) {
+    if (x != x) { return 1; }
+    return signbit(x) ? 0 : 1;
+}
+
+static void check_point_ddf(double x, bool * d, float * q) {
+    *d = !(signbit(x) && (x == x));
+    *q = 0;
+}
+
+// The truncated generators order the endpoints as their lex indexes, in
+// which -0.0 precedes +0.0, and reject a NaN endpoint.
+static void check_truncated(struct flip_state * prng) {
+    double x = generate_opt_truncated(check_point_cdf, -0.0, +0.0, prng);
+    check_true((x == 0) && !signbit(x), "truncated(point, -0.0, +0.0)");
+    x = generate_opt_truncated_ext(check_point_ddf, -0.0, +0.0, prng);
+    check_true((x == 0) && !signbit(x), "truncated_ext(point, -0.0, +0.0)");
+    x = generate_opt_truncated(check_point_cdf, +0.0, -0.0, prng);
+    check_true(isnan(x), "truncated(point, +0.0, -0.0)");
+    x = generate_opt_truncated(check_point_cdf, +0.0, +0.0, prng);
+    check_true(isnan(x), "truncated(point, +0.0, +0.0)");
+    x = generate_opt_truncated(check_point_cdf, NAN, +0.0, prng);
+    check_true(isnan(x), "truncated(point, nan, +0.0)");
+    x = generate_opt_truncated(check_point_cdf, -1, NAN, prng);
+    check_true(isnan(x), "truncated(point, -1, nan)");
+}
+
+MAKE_CDF_P(check_normal_P, dist_normal_P, 0, 1)
+MAKE_DDF_DIST(check_normal_D, dist_normal_D, 0, 1)
+MAKE_CDF_BATCH(check_normal_P_n, dist_normal_P_n, 0, 1)
+
+static float check_normal_cdf(double x, const void * ctx) {
+    (void) ctx;
+    return dist_normal_P(x, 0, 1);
+}
+
+// Two identical streams, the first for generate_opt and the second for the
+// generator compared with it.
+struct check_pair {
+    gsl_rng * rng[2];
+    struct flip_state prng[2];
+    bool same;              // Whether every variate and flip count agreed.
+};
+
+static void check_pair_init(struct check_pair * p) {
+    for (int i = 0; i < 2; i++) {
+        p->rng[i] = gsl_rng_alloc(gsl_rng_default);
+        gsl_rng_set(p->rng[i], CHECK_SEED);
+        p->prng[i] = make_flip_state(p->rng[i]);
+    }
+    p->same = true;
+}
+
+// Compare the variate x of generate_opt with y of the other generator.
+static void check_pair_step(struct check_pair * p, double x, double y) {
+    if ((memcmp(&x, &y, sizeof(x)) != 0)
+            || (p->prng[0].num_flips != p->prng[1].num_flips)) {
+        p->same = false;
+    }
+}
+
+static void check_pair_free(struct check_pair * p, const char * name) {
+    check_true(p->same, name);
+    gsl_rng_free(p->rng[0]);
+    gsl_rng_free(p->rng[1]);
+}
+
+// A sampler whose trie holds a few nodes, so that most draws evict one.
+static void check_sampler(size_t max_bytes, const char * name, const char * name_ext) {
+    struct check_pair p;
+    check_pair_init(&p);
+    struct rvg_sampler * sampler = rvg_sampler_alloc(check_normal_P, max_bytes);
+    for (int i = 0; i < CHECK_DRAWS; i++) {
+        double x = generate_opt(check_normal_P, &p.prng[0]);
+        check_pair_step(&p, x, rvg_sampler_generate_opt(sampler, &p.prng[1]));
+    }
+    check_true((max_bytes == SAMPLER_DEFAULT_BYTES) || (0 < sampler->num_evictions), name);
+    rvg_sampler_free(sampler);
+    check_pair_free(&p, name);
+
+    check_pair_init(&p);
+    sampler = rvg_sampler_alloc_ext(check_normal_D, max_bytes);
+    for (int i = 0; i < CHECK_DRAWS; i++) {
+        double x = generate_opt_ext(check_normal_D, &p.prng[0]);
+        check_pair_step(&p, x, rvg_sampler_generate_opt(sampler, &p.prng[1]));
+    }
+    rvg_sampler_free(sampler);
+    check_pair_free(&p, name_ext);
+}
+
+static void check_table(void) {
+    struct check_pair p;
+    check_pair_init(&p);
+    struct rvg_table * table = NULL;
+    if (rvg_table_build(check_normal_P, 1 << 16, CHECK_TABLE_PATH) == 0) {
+        table = rvg_table_open(CHECK_TABLE_PATH, check_normal_P, true);
+    }
+    check_true(table != NULL, "table open");
+    for (int i = 0; (table != NULL) && (i < CHECK_DRAWS); i++) {
+        double x = generate_opt(check_normal_P, &p.prng[0]);
+        check_pair_step(&p, x, rvg_table_generate_opt(table, &p.prng[1]));
+    }
+    if (table != NULL) { rvg_table_close(table); }
+    check_pair_free(&p, "table");
+
+    check_pair_init(&p);
+    table = NULL;
+    if (rvg_table_build_ext(check_normal_D, 1 << 16, CHECK_TABLE_PATH) == 0) {
+        table = rvg_table_open_ext(CHECK_TABLE_PATH, check_normal_D, true);
+    }
+    check_true(table != NULL, "table_ext open");
+    for (int i = 0; (table != NULL) && (i < CHECK_DRAWS); i++) {
+        double x = generate_opt_ext(check_normal_D, &p.prng[0]);
+        check_pair_step(&p, x, rvg_table_generate_opt(table, &p.prng[1]));
+    }
+    if (table != NULL) { rvg_table_close(table); }
+    check_pair_free(&p, "table_ext");
+    remove(CHECK_TABLE_PATH);
+}
+
+// The traversals of a batch interleave their flips, so each variate of a
+// batch of one is compared.
+static void check_batch(void) {
+    struct check_pair p;
+    check_pair_init(&p);
+    for (int i = 0; i < CHECK_DRAWS; i++) {
+        double x = generate_opt(check_normal_P, &p.prng[0]);
+        double y;
+        if (generate_opt_n(check_normal_P_n, &p.prng[1], &y, 1) != 0) { y = NAN; }
+        check_pair_step(&p, x, y);
+    }
+    check_pair_free(&p, "batch");
+}
+
+// The DDG tree of a compiled discrete distribution need not order its
+// leaves as the lex tree, so its draws differ from those of generate_opt.
+// Instead, outcome k must have one leaf at depth j exactly when bit j of
+// its probability is set, so that the tree is exact and entropy-optimal,
+// and consumes the same expected number of flips as generate_opt.
+static void check_discrete(const float * P, size_t K, const char * name) {
+    struct rvg_discrete * table = rvg_discrete_compile(P, K);
+    if (table == NULL) {
+        check_true(false, name);
+        return;
+    }
+    bool ok = table->depth < DISCRETE_FIX_BITS;
+    fix_t lo, hi, w;
+    fix_from_float(0, lo);
+    for (size_t k = 0; k <= K; k++) {
+        fix_from_float((k < K) ? P[k] : 1, hi);
+        fix_sub(hi, lo, w);
+        for (unsigned int j = 1; j < DISCRETE_FIX_BITS; j++) {
+            unsigned int count = 0;
+            if (j <= table->depth) {
+                const struct rvg_discrete_level * level = &table->levels[j - 1];
+                for (uint32_t i = 0; i < level->count; i++) {
+                    count += (table->leaves[level->offset + i] == k);
+                }
+            }
+            ok = ok && (count == fix_bit(w, DISCRETE_FIX_BITS - 1 - j));
+        }
+        memcpy(lo, hi, sizeof(fix_t));
+    }
+    check_true(ok, name);
+    rvg_discrete_free(table);
+}
+
+
+// Number of variates of a job of the pool, which is not a multiple of
+// RVG_POOL_GRAIN.
+#define CHECK_POOL_N 1000
+
+// The variates of a pool are a function of the seed and of the sizes of
+// the jobs, for any number of threads.
+static void check_pool(const gsl_rng_type * T, const char * name) {
+    static double x[2][2][CHECK_POOL_N];
+    static const unsigned int num_threads[2] = {1, 4};
+    for (int i = 0; i < 2; i++) {
+        struct rvg_pool * pool = rvg_pool_alloc(num_threads[i], T, 42);
+        if (pool == NULL) {
+            check_true(false, name);
+            return;
+        }
+        rvg_pool_generate_ctx(pool, check_normal_cdf, NULL, x[i][0], CHECK_POOL_N);
+        rvg_pool_generate_ctx(pool, check_normal_cdf, NULL, x[i][1], CHECK_POOL_N);
+        rvg_pool_free(pool);
+    }
+    check_true(memcmp(x[0], x[1], sizeof(x[0])) == 0, name);
+    check_true(memcmp(x[0][0], x[0][1], sizeof(x[0][0])) != 0, name);
+}
+
+// Known-answer vectors of Philox4x32-10 from Random123, as the 32-bit words
+// of the key, of the counter, and of the output, from least significant.
+static const struct {
+    uint32_t key[2];
+    uint32_t ctr[4];
+    uint32_t out[4];
+} check_philox_kat[] = {
+    {{0x00000000, 0x00000000},
+     {0x00000000, 0x00000000, 0x00000000, 0x00000000},
+     {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+    {{0xffffffff, 0xffffffff},
+     {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+     {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+    {{0xa4093822, 0x299f31d0},
+     {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+     {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+};
+
+static void check_philox(void) {
+    size_t num_kat = sizeof(check_philox_kat) / sizeof(check_philox_kat[0]);
+    for (size_t i = 0; i < num_kat; i++) {
+        const uint32_t * c = check_philox_kat[i].ctr;
+        const uint32_t * o = check_philox_kat[i].out;
+        uint64_t out[2];
+        philox_block(check_philox_kat[i].key,
+            ((uint64_t) c[1] << 32) | c[0],
+            ((uint64_t) c[3] << 32) | c[2], out);
+        check_true((out[0] == (((uint64_t) o[1] << 32) | o[0]))
+            && (out[1] == (((uint64_t) o[3] << 32) | o[2])), "philox_block");
+    }
+    // The first vector is also word 0 and 1 of stream 0 of seed 0.
+    gsl_rng * rng = gsl_rng_alloc(gsl_rng_philox);
+    philox_set(rng, 0, 0, 0);
+    uint64_t w0 = gsl_rng_get(rng);
+    uint64_t w1 = gsl_rng_get(rng);
+    check_true((w0 == 0xe169c58d6627e8d5ull) && (w1 == 0x9b00dbd8bc57ac4cull), "philox_set");
+    gsl_rng_free(rng);
+}
+
+int main(void) {
+
+    static const double shapes[] = {
+        0.01, 0.1, 0.5, 1, 1.5, 2.5, 7.25, 9.999, 10, 10.5, 33.3, 100,
+        1000.5, 6452.2030170040834, 12345.678, 1e5, 1e6, 1e7,
+    };
+    size_t num_shapes = sizeof(shapes) / sizeof(shapes[0]);
+
+    // Gamma: the series for P is used for x < a + 1, and the continued
+    // fraction for Q otherwise.
+    for (size_t i = 0; i < num_shapes; i++) {
+        check_gamma(shapes[i], shapes[i] + 1);
+    }
+
+    // Beta: the continued fraction for I_x(a, b) is used for
+    // x < (a + 1) / (a + b + 2), and that for I_{1-x}(b, a) otherwise.
+    for (size_t i = 0; i < num_shapes; i++) {
+        for (size_t j = 0; j < num_shapes; j++) {
+            double a = shapes[i];
+            double b = shapes[j];
+            check_beta(a, b, (a + 1) / (a + b + 2));
+        }
+    }
+
+    // Poisson: Pr(X <= k) = Q(k + 1, mu), which switches at k = mu - 2.
+    for (size_t i = 0; i < num_shapes; i++) {
+        double mu = shapes[i];
+        if (1e5 < mu) { continue; }
+        check_poisson(mu, 2 * mu + 100);
+    }
+
+    // Binomial: Pr(X <= k) = I_{1-p}(n - k, k + 1).
+    static const double probs[] = {0.001, 0.1, 0.3, 0.5, 0.9, 0.999};
+    static const unsigned int trials[] = {1, 10, 100, 1000, 100000};
+    for (size_t i = 0; i < sizeof(probs) / sizeof(probs[0]); i++) {
+        for (size_t j = 0; j < sizeof(trials) / sizeof(trials[0]); j++) {
+            check_binomial(probs[i], trials[j]);
+        }
+    }
+
+    // Generators.
+    gsl_rng * rng = gsl_rng_alloc(gsl_rng_default);
+    struct flip_state prng = make_flip_state(rng);
+    check_truncated(&prng);
+    gsl_rng_free(rng);
+    check_sampler(SAMPLER_DEFAULT_BYTES, "sampler", "sampler_ext");
+    check_sampler(4 * sizeof(struct sampler_node), "sampler(evict)", "sampler_ext(evict)");
+    check_table();
+    check_batch();
+    static const float P1[5] = {0.1, 0.3, 0.3, 0.55, 0.8};
+    static const float P2[3] = {0x1p-140, 0.5, 1 - 0x1p-24};
+    check_discrete(P1, 5, "discrete(P1)");
+    check_discrete(P2, 3, "discrete(P2)");
+    check_philox();
+    check_pool(gsl_rng_philox, "pool(philox)");
+    check_pool(gsl_rng_default, "pool(default)");
+
+    printf("%lu violations\n", check_failures);
+    return check_failures != 0;
+}
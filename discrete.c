@@ -5,12 +5,169 @@
   Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
 */
 
+#include <assert.h>
 #include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arithmetic.h"
+#include "bits.h"
+#include "flip.h"
 #include "discrete.h"
 
-float cdf_discrete(double x, const float P[], size_t K) {
-    if      (x != x)        { return 1.; }       // nan
-    else if (signbit(x))    { return 0; }        // <= -0.0
-    else if (K <= x)        { return 1; }
-    else                    { return P[(size_t)x]; }
+extern inline float cdf_discrete(double x, const float *P, size_t K);
+
+// ================ Compiled DDG Trees ================
+
+// Each probability is a fixed-point integer w[0] + w[1] 2^64 + w[2] 2^128
+// over a common power of two 2^k. Level j of the Knuth-Yao DDG tree
+// contains a leaf for each outcome whose probability has bit k - j set
+// [Knuth and Yao 1976], and the table of levels is walked using
+// `flip`, as in the Fast Loaded Dice Roller [Saad et al. 2020].
+
+// Round n bytes up to a whole number of cache lines.
+static size_t cache_lines(size_t n) {
+    return ((n + DISCRETE_CACHE_LINE - 1) / DISCRETE_CACHE_LINE) * DISCRETE_CACHE_LINE;
+}
+
+// Build the DDG tree of n outcomes with labels X and probabilities W / 2^k,
+// where the sum of W is 2^k.
+static struct rvg_discrete * discrete_build(
+        size_t K,
+        const fix_t * W,
+        const uint32_t * X,
+        size_t n,
+        unsigned int k
+        ) {
+
+    // Compute depth and number of leaves.
+    unsigned int depth = 0;
+    size_t num_leaves = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (fix_zero(W[i])) { continue; }
+        depth = max(depth, k - fix_ctz(W[i]));
+        for (unsigned int j = 0; j < FIX_WORDS; j++) {
+            num_leaves += __builtin_popcountll(W[i][j]);
+        }
+    }
+    if (UINT32_MAX < num_leaves) { return NULL; }
+
+    struct rvg_discrete * table = malloc(sizeof(*table));
+    if (table == NULL) { return NULL; }
+    table->K = K;
+    table->depth = depth;
+    table->levels = aligned_alloc(DISCRETE_CACHE_LINE,
+        cache_lines((depth + 1) * sizeof(struct rvg_discrete_level)));
+    table->leaves = aligned_alloc(DISCRETE_CACHE_LINE,
+        cache_lines(num_leaves * sizeof(uint32_t)));
+    if ((table->levels == NULL) || (table->leaves == NULL)) {
+        rvg_discrete_free(table);
+        return NULL;
+    }
+
+    // Point mass, with a leaf at the root.
+    if (depth == 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (!fix_zero(W[i])) { table->leaves[0] = X[i]; }
+        }
+        return table;
+    }
+
+    // Fill the leaves of levels 1, ..., depth.
+    uint32_t offset = 0;
+    for (unsigned int j = 1; j <= depth; j++) {
+        struct rvg_discrete_level * level = &table->levels[j - 1];
+        level->offset = offset;
+        for (size_t i = 0; i < n; i++) {
+            if (fix_bit(W[i], k - j)) {
+                table->leaves[offset++] = X[i];
+            }
+        }
+        level->count = offset - level->offset;
+    }
+    assert(offset == num_leaves);
+    return table;
+}
+
+struct rvg_discrete * rvg_discrete_compile(const float *P, size_t K) {
+    if (DISCRETE_REJECT <= K) { return NULL; }
+    for (size_t i = 0; i < K; i++) {
+        float p_l = (i == 0) ? 0 : P[i - 1];
+        if (!((p_l <= P[i]) && (P[i] <= 1))) { return NULL; }
+    }
+
+    fix_t * W = malloc((K + 1) * sizeof(fix_t));
+    uint32_t * X = malloc((K + 1) * sizeof(uint32_t));
+    struct rvg_discrete * table = NULL;
+    if ((W != NULL) && (X != NULL)) {
+        // The atom at i has mass P[i] - P[i-1], and the atom at K has 1 - P[K-1].
+        fix_t cdf_l = {0, 0, 0};
+        fix_t cdf_r;
+        for (size_t i = 0; i <= K; i++) {
+            fix_from_float((i < K) ? P[i] : 1, cdf_r);
+            fix_sub(cdf_r, cdf_l, W[i]);
+            memcpy(cdf_l, cdf_r, sizeof(fix_t));
+            X[i] = i;
+        }
+        table = discrete_build(K, (const fix_t *) W, X, K + 1, DISCRETE_FIX_BITS - 1);
+    }
+    free(W);
+    free(X);
+    return table;
+}
+
+struct rvg_discrete * rvg_discrete_compile_weights(const uint64_t *W, size_t K) {
+    if (DISCRETE_REJECT <= K) { return NULL; }
+
+    // Total weight m, padded to 2^k by a rejected outcome.
+    unsigned __int128 m = 0;
+    for (size_t i = 0; i < K; i++) {
+        m += W[i];
+    }
+    if ((m == 0) || (UINT64_MAX < m)) { return NULL; }
+    unsigned int k = (m == 1) ? 0 : 64 - __builtin_clzll((uint64_t)(m - 1));
+    unsigned __int128 r = ((unsigned __int128)1 << k) - m;
+
+    fix_t * WW = calloc(K + 1, sizeof(fix_t));
+    uint32_t * X = malloc((K + 1) * sizeof(uint32_t));
+    struct rvg_discrete * table = NULL;
+    if ((WW != NULL) && (X != NULL)) {
+        for (size_t i = 0; i < K; i++) {
+            WW[i][0] = W[i];
+            X[i] = i;
+        }
+        WW[K][0] = (uint64_t) r;
+        WW[K][1] = (uint64_t) (r >> 64);
+        X[K] = DISCRETE_REJECT;
+        table = discrete_build(K, (const fix_t *) WW, X, K + 1, k);
+    }
+    free(WW);
+    free(X);
+    return table;
+}
+
+size_t rvg_discrete_sample(const struct rvg_discrete * table, struct flip_state * prng) {
+    if (table->depth == 0) {
+        return table->leaves[0];
+    }
+    while (1) {
+        uint64_t d = 0;
+        for (unsigned int j = 0; j < table->depth; j++) {
+            d = (d << 1) | flip(prng);
+            const struct rvg_discrete_level * level = &table->levels[j];
+            if (d < level->count) {
+                uint32_t x = table->leaves[level->offset + d];
+                if (x == DISCRETE_REJECT) { break; }
+                return x;
+            }
+            d -= level->count;
+        }
+    }
+}
+
+void rvg_discrete_free(struct rvg_discrete * table) {
+    free(table->levels);
+    free(table->leaves);
+    free(table);
 }
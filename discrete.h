@@ -8,8 +8,59 @@
 #ifndef DISCRETE_H
 #define DISCRETE_H
 
+#include <math.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#include "arithmetic.h"
+#include "flip.h"
+
+/* Wrap array of cumulative probabilities into a CDF. It is inline so that
+   it can be inlined into the generators of generate_inline.h, and its
+   external definition is in discrete.c. */
+inline float cdf_discrete(double x, const float *P, size_t K) {
+    if      (x != x)        { return 1.; }       // nan
+    else if (signbit(x))    { return 0; }        // <= -0.0
+    else if (K <= x)        { return 1; }
+    else                    { return P[(size_t)x]; }
+}
+
+// Number of bits in the fixed-point representation of a float in [0, 1],
+// which is an integer multiple of 2^-149.
+#define DISCRETE_FIX_BITS FIX_BITS
+#define DISCRETE_FIX_WORDS FIX_WORDS
+
+// Alignment of the tables of a compiled distribution.
+#define DISCRETE_CACHE_LINE 64
+
+// Leaf of a rejected outcome in a table compiled from integer weights.
+#define DISCRETE_REJECT UINT32_MAX
+
+// Level of a discrete distribution generating (DDG) tree: the leaves at
+// depth j are leaves[offset], ..., leaves[offset + count - 1].
+struct rvg_discrete_level {
+    uint32_t count;
+    uint32_t offset;
+};
+
+/** A discrete distribution compiled into a flat DDG tree. */
+struct rvg_discrete {
+    size_t K;                               // Number of outcomes.
+    unsigned int depth;                     // Depth of the DDG tree.
+    struct rvg_discrete_level * levels;     // Levels 1, ..., depth.
+    uint32_t * leaves;                      // Outcomes at the leaves.
+};
+
+/** Compile the distribution of `cdf_discrete` with cumulative probabilities `P`. */
+struct rvg_discrete * rvg_discrete_compile(const float *P, size_t K);
+
+/** Compile the distribution with probabilities proportional to integers `W`. */
+struct rvg_discrete * rvg_discrete_compile_weights(const uint64_t *W, size_t K);
+
+/** Generate a random outcome from a compiled discrete distribution. */
+size_t rvg_discrete_sample(const struct rvg_discrete * table, struct flip_state * prng);
+
+/** Free a compiled discrete distribution. */
+void rvg_discrete_free(struct rvg_discrete * table);
 
-/* Wrap array of cumulative probabilities into a CDF. */
-float cdf_discrete(double x, const float *P, size_t K);
 #endif
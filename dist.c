@@ -0,0 +1,308 @@
+/*
+  Name:     dist.c
+  Purpose:  Catalog of CDF, SF, and DDF kernels for common distributions.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dist.h"
+
+// Largest float below 0.5, the largest permitted SF value of a DDF.
+#define DIST_SF_MAX 0x1.fffffep-2f
+
+// Tolerances for series and continued fractions.
+#define DIST_EPS DBL_EPSILON
+#define DIST_TINY 1e-300
+#define DIST_MAX_ITER 1000000
+
+// ================ Special Functions ================
+
+// Shape above which the prefactors of the incomplete gamma and beta
+// functions use the Stirling series rather than lgamma.
+#define DIST_STIRLING_MIN 15
+
+// Deviance a log(a/m) + m - a, computed without cancellation when a and m
+// are close [loader2000].
+static double dist_bd0(double a, double m) {
+    if (fabs(a - m) < 0.1 * (a + m)) {
+        double v = (a - m) / (a + m);
+        double s = (a - m) * v;
+        double ej = 2 * a * v;
+        v = v * v;
+        for (int j = 1; j < DIST_MAX_ITER; j++) {
+            ej *= v;
+            double s1 = s + ej / (2 * j + 1);
+            if (s1 == s) { break; }
+            s = s1;
+        }
+        return s;
+    }
+    return a * log(a / m) + m - a;
+}
+
+// Error lgamma(a) - ((a - 1/2) log(a) - a + log(2 pi)/2) of the Stirling
+// approximation, for a >= DIST_STIRLING_MIN.
+static double dist_stirlerr(double a) {
+    double a2 = a * a;
+    return (1./12 - (1./360 - (1./1260 - (1./1680 - 1./(1188 * a2)) / a2) / a2) / a2) / a;
+}
+
+// Regularized incomplete gamma functions p = P(a, x) and q = Q(a, x),
+// using the series for P when x < a + 1 and the continued fraction for Q
+// otherwise [press1992, Section 6.2]. The prefactor x^a e^{-x} / Gamma(a)
+// of both is computed from the deviance for large a, since the terms of
+// a log(x) - x - lgamma(a) cancel and their rounding errors would make
+// P and Q nonmonotone in x.
+static void gamma_pq(double a, double x, double * p, double * q) {
+    assert(0 < a);
+    if (!(0 < x))       { *p = 0; *q = 1; return; }
+    if (isinf(x))       { *p = 1; *q = 0; return; }
+    double front = (a < DIST_STIRLING_MIN)
+        ? exp(a * log(x) - x - lgamma(a))
+        : sqrt(a / (2 * M_PI)) * exp(-dist_bd0(a, x) - dist_stirlerr(a));
+    if (x < a + 1) {
+        double ap = a;
+        double del = 1 / a;
+        double sum = del;
+        for (int i = 0; i < DIST_MAX_ITER; i++) {
+            ap += 1;
+            del *= x / ap;
+            sum += del;
+            if (fabs(del) < fabs(sum) * DIST_EPS) { break; }
+        }
+        *p = fmin(sum * front, 1);
+        *q = 1 - *p;
+    } else {
+        double b = x + 1 - a;
+        double c = 1 / DIST_TINY;
+        double d = 1 / b;
+        double h = d;
+        for (int i = 1; i < DIST_MAX_ITER; i++) {
+            double an = -i * (i - a);
+            b += 2;
+            d = an * d + b;
+            if (fabs(d) < DIST_TINY) { d = DIST_TINY; }
+            c = b + an / c;
+            if (fabs(c) < DIST_TINY) { c = DIST_TINY; }
+            d = 1 / d;
+            double del = d * c;
+            h *= del;
+            if (fabs(del - 1) < DIST_EPS) { break; }
+        }
+        *q = fmin(front * h, 1);
+        *p = 1 - *q;
+    }
+}
+
+// Continued fraction for the incomplete beta function, where y = 1 - x and
+// I_x(a, b) = x^a y^b / B(a, b) / beta_cf(a, b, x, y) [didonato1992]. Its
+// terms use y through lambda = a - (a + b) x, so that they do not cancel
+// when x is near 1, unlike those of [press1992, Section 6.4].
+static double beta_cf(double a, double b, double x, double y) {
+    double lambda = a * y - b * x;
+    double f = a * (lambda + 1) / (a + 1);
+    if (fabs(f) < DIST_TINY) { f = DIST_TINY; }
+    double c = f;
+    double d = 0;
+    for (int m = 1; m < DIST_MAX_ITER; m++) {
+        double e = a + 2 * m - 1;
+        double an = (a + m - 1) * (a + b + m - 1) * m * (b - m) * x * x / (e * e);
+        double bn = m + m * (b - m) * x / e
+            + (a + m) * (lambda + 1 + m * (2 - x)) / (e + 2);
+        d = bn + an * d;
+        if (fabs(d) < DIST_TINY) { d = DIST_TINY; }
+        c = bn + an / c;
+        if (fabs(c) < DIST_TINY) { c = DIST_TINY; }
+        d = 1 / d;
+        double del = c * d;
+        f *= del;
+        if (fabs(del - 1) < DIST_EPS) { break; }
+    }
+    return f;
+}
+
+// Logarithm of the prefactor x^a y^b / B(a, b) of the incomplete beta
+// function, where x + y = 1. Large shapes use the deviance, as in gamma_pq.
+static double beta_log_front(double x, double y, double a, double b) {
+    bool large_a = DIST_STIRLING_MIN <= a;
+    bool large_b = DIST_STIRLING_MIN <= b;
+    double s = a + b;
+    if (large_a && large_b) {
+        return 0.5 * log(a * b / (2 * M_PI * s))
+            - dist_bd0(a, s * x) - dist_bd0(b, s * y)
+            + dist_stirlerr(s) - dist_stirlerr(a) - dist_stirlerr(b);
+    }
+    if (large_a) {
+        return -dist_bd0(a, s * x) + b * log(s * y) - s * y - lgamma(b)
+            - 0.5 * log1p(b / a) + dist_stirlerr(s) - dist_stirlerr(a);
+    }
+    if (large_b) {
+        return -dist_bd0(b, s * y) + a * log(s * x) - s * x - lgamma(a)
+            - 0.5 * log1p(a / b) + dist_stirlerr(s) - dist_stirlerr(b);
+    }
+    return lgamma(s) - lgamma(a) - lgamma(b) + a * log(x) + b * log(y);
+}
+
+// Regularized incomplete beta function p = I_x(a, b) and q = 1 - p, where
+// y = 1 - x is given separately to retain its precision near x = 1.
+static void beta_pq(double x, double y, double a, double b, double * p, double * q) {
+    assert((0 < a) && (0 < b));
+    if (!(0 < x))       { *p = 0; *q = 1; return; }
+    if (!(0 < y))       { *p = 1; *q = 0; return; }
+    double front = exp(beta_log_front(x, y, a, b));
+    if (x < (a + 1) / (a + b + 2)) {
+        *p = fmin(front / beta_cf(a, b, x, y), 1);
+        *q = 1 - *p;
+    } else {
+        *q = fmin(front / beta_cf(b, a, y, x), 1);
+        *p = 1 - *q;
+    }
+}
+
+// ================ Distributions ================
+
+// Each function sets p = Pr(X <= x) and q = Pr(X > x) in double precision.
+
+static void normal_pq(double x, double * p, double * q, double mu, double sigma) {
+    assert(0 < sigma);
+    if (x != x) { *p = 1; *q = 0; return; }
+    double z = (x - mu) / (sigma * M_SQRT2);
+    *p = 0.5 * erfc(-z);
+    *q = 0.5 * erfc(z);
+}
+
+static void exponential_pq(double x, double * p, double * q, double mu) {
+    assert(0 < mu);
+    if (x != x) { *p = 1; *q = 0; return; }
+    if (x < 0)  { *p = 0; *q = 1; return; }
+    *p = -expm1(-x / mu);
+    *q = exp(-x / mu);
+}
+
+static void gamma_dist_pq(double x, double * p, double * q, double a, double b) {
+    assert(0 < b);
+    if (x != x) { *p = 1; *q = 0; return; }
+    gamma_pq(a, x / b, p, q);
+}
+
+static void beta_dist_pq(double x, double * p, double * q, double a, double b) {
+    if (x != x) { *p = 1; *q = 0; return; }
+    beta_pq(x, 1 - x, a, b, p, q);
+}
+
+static void tdist_pq(double x, double * p, double * q, double nu) {
+    assert(0 < nu);
+    if (x != x) { *p = 1; *q = 0; return; }
+    // Pr(|T| > |x|) = I_{nu/(nu+x^2)}(nu/2, 1/2).
+    double x2 = x * x;
+    double tail, body;
+    if (isinf(x2)) {
+        tail = 0; body = 1;
+    } else {
+        beta_pq(nu / (nu + x2), x2 / (nu + x2), nu / 2, 0.5, &tail, &body);
+    }
+    double lo = tail / 2;
+    double hi = 1 - lo;
+    *p = signbit(x) ? lo : hi;
+    *q = signbit(x) ? hi : lo;
+}
+
+static void poisson_pq(double x, double * p, double * q, double mu) {
+    assert(0 < mu);
+    if (x != x)     { *p = 1; *q = 0; return; }
+    if (signbit(x)) { *p = 0; *q = 1; return; }
+    // Pr(X <= k) = Q(k + 1, mu).
+    gamma_pq(floor(x) + 1, mu, q, p);
+}
+
+static void binomial_pq(double x, double * p, double * q, double pp, unsigned int n) {
+    assert((0 <= pp) && (pp <= 1));
+    if (x != x)     { *p = 1; *q = 0; return; }
+    if (signbit(x)) { *p = 0; *q = 1; return; }
+    double k = floor(x);
+    if (n <= k)     { *p = 1; *q = 0; return; }
+    // Pr(X <= k) = I_{1-p}(n - k, k + 1).
+    beta_pq(1 - pp, pp, n - k, k + 1, p, q);
+}
+
+static void geometric_pq(double x, double * p, double * q, double pp) {
+    assert((0 < pp) && (pp <= 1));
+    if (x != x)     { *p = 1; *q = 0; return; }
+    double k = floor(x);
+    if (k < 1)      { *p = 0; *q = 1; return; }
+    // Pr(X > k) = (1 - p)^k.
+    double lq = k * log1p(-pp);
+    *p = -expm1(lq);
+    *q = exp(lq);
+}
+
+// ================ Kernels ================
+
+static inline void dist_ddf(double p, double q, bool * d, float * r) {
+    float pf = p;
+    if (pf <= 0.5) {
+        *d = 0;
+        *r = pf;
+    } else {
+        *d = 1;
+        *r = fminf(q, DIST_SF_MAX);
+    }
+}
+
+#define DIST_EXPAND(...) __VA_ARGS__
+
+#define DIST_DEFINE(name, pq, params, args)                                     \
+    float dist_##name##_P(double x, DIST_EXPAND params) {                       \
+        double p, q;                                                            \
+        pq(x, &p, &q, DIST_EXPAND args);                                        \
+        return p;                                                               \
+    }                                                                           \
+    float dist_##name##_Q(double x, DIST_EXPAND params) {                       \
+        double p, q;                                                            \
+        pq(x, &p, &q, DIST_EXPAND args);                                        \
+        return q;                                                               \
+    }                                                                           \
+    void dist_##name##_D(double x, bool * d, float * r, DIST_EXPAND params) {   \
+        double p, q;                                                            \
+        pq(x, &p, &q, DIST_EXPAND args);                                        \
+        dist_ddf(p, q, d, r);                                                   \
+    }                                                                           \
+    void dist_##name##_P_n(const double * x, float * out, size_t m,             \
+            DIST_EXPAND params) {                                               \
+        for (size_t i = 0; i < m; i++) {                                        \
+            double p, q;                                                        \
+            pq(x[i], &p, &q, DIST_EXPAND args);                                 \
+            out[i] = p;                                                         \
+        }                                                                       \
+    }                                                                           \
+    void dist_##name##_Q_n(const double * x, float * out, size_t m,             \
+            DIST_EXPAND params) {                                               \
+        for (size_t i = 0; i < m; i++) {                                        \
+            double p, q;                                                        \
+            pq(x[i], &p, &q, DIST_EXPAND args);                                 \
+            out[i] = q;                                                         \
+        }                                                                       \
+    }                                                                           \
+    void dist_##name##_D_n(const double * x, bool * d, float * r, size_t m,     \
+            DIST_EXPAND params) {                                               \
+        for (size_t i = 0; i < m; i++) {                                        \
+            double p, q;                                                        \
+            pq(x[i], &p, &q, DIST_EXPAND args);                                 \
+            dist_ddf(p, q, &d[i], &r[i]);                                       \
+        }                                                                       \
+    }
+
+DIST_DEFINE(normal, normal_pq, (double mu, double sigma), (mu, sigma))
+DIST_DEFINE(exponential, exponential_pq, (double mu), (mu))
+DIST_DEFINE(gamma, gamma_dist_pq, (double a, double b), (a, b))
+DIST_DEFINE(beta, beta_dist_pq, (double a, double b), (a, b))
+DIST_DEFINE(tdist, tdist_pq, (double nu), (nu))
+DIST_DEFINE(poisson, poisson_pq, (double mu), (mu))
+DIST_DEFINE(binomial, binomial_pq, (double pp, unsigned int n), (pp, n))
+DIST_DEFINE(geometric, geometric_pq, (double pp), (pp))
@@ -0,0 +1,89 @@
+/*
+  Name:     dist.h
+  Purpose:  Catalog of CDF, SF, and DDF kernels for common distributions.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#ifndef DIST_H
+#define DIST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Each distribution `name` provides the following kernels, whose trailing
+// arguments are the parameters of the distribution (in the order of GSL).
+//
+//  float dist_name_P(double x, ...)        CDF, a valid cdf32_t.
+//  float dist_name_Q(double x, ...)        SF, a valid cdf32_t.
+//  void  dist_name_D(double x, bool * d, float * r, ...)
+//                                          DDF, a valid ddf32_t.
+//  void  dist_name_P_n(const double * x, float * out, size_t m, ...)
+//  void  dist_name_Q_n(const double * x, float * out, size_t m, ...)
+//  void  dist_name_D_n(const double * x, bool * d, float * r, size_t m, ...)
+//                                          Batched versions, which loop
+//                                          over the scalar kernel (the
+//                                          special functions are scalar
+//                                          libm calls) and only save the
+//                                          indirect call per midpoint.
+//
+// All kernels are computed in double precision and rounded to float, return
+// CDF 1 (SF 0) at NaN, and the discrete distributions are supported on the
+// nonnegative integers, with an atom at +0.0 (not -0.0), as in
+// MAKE_CDF_UINT_P. The DDF uses the CDF at x while the rounded CDF is at most
+// 0.5 and the SF (capped below 0.5) otherwise, so it satisfies the
+// conditions of MAKE_DDF by construction and needs no runtime cutoff.
+
+#define DIST_DECLARE(name, ...)                                                 \
+    float dist_##name##_P(double x, __VA_ARGS__);                               \
+    float dist_##name##_Q(double x, __VA_ARGS__);                               \
+    void dist_##name##_D(double x, bool * d, float * r, __VA_ARGS__);           \
+    void dist_##name##_P_n(const double * x, float * out, size_t m, __VA_ARGS__); \
+    void dist_##name##_Q_n(const double * x, float * out, size_t m, __VA_ARGS__); \
+    void dist_##name##_D_n(const double * x, bool * d, float * r, size_t m, __VA_ARGS__);
+
+/** Normal distribution with mean `mu` and standard deviation `sigma`. */
+DIST_DECLARE(normal, double mu, double sigma)
+
+/** Exponential distribution with mean `mu`. */
+DIST_DECLARE(exponential, double mu)
+
+/** Gamma distribution with shape `a` and scale `b`. */
+DIST_DECLARE(gamma, double a, double b)
+
+/** Beta distribution with shapes `a` and `b`. */
+DIST_DECLARE(beta, double a, double b)
+
+/** Student t distribution with `nu` degrees of freedom. */
+DIST_DECLARE(tdist, double nu)
+
+/** Poisson distribution with mean `mu`. */
+DIST_DECLARE(poisson, double mu)
+
+/** Binomial distribution with success probability `p` and `n` trials. */
+DIST_DECLARE(binomial, double p, unsigned int n)
+
+/** Geometric distribution over 1, 2, ... with success probability `p`. */
+DIST_DECLARE(geometric, double p)
+
+// Macros for creating a compatible DDF and batched CDF, SF, and DDF.
+
+/** Make a dual distribution function from a catalog kernel. */
+#define MAKE_DDF_DIST(name, func, ...)                  \
+  void name(double x__, bool * d__, float * p__) {      \
+    func(x__, d__, p__, ##__VA_ARGS__);                 \
+  }
+
+/** Make a batched cumulative or survival function from a catalog kernel. */
+#define MAKE_CDF_BATCH(name, func, ...)                         \
+  void name(const double * x__, float * out__, size_t m__) {    \
+    func(x__, out__, m__, ##__VA_ARGS__);                       \
+  }
+
+/** Make a batched dual distribution function from a catalog kernel. */
+#define MAKE_DDF_BATCH(name, func, ...)                                     \
+  void name(const double * x__, bool * d__, float * p__, size_t m__) {      \
+    func(x__, d__, p__, m__, ##__VA_ARGS__);                                \
+  }
+
+#endif
@@ -1,9 +1,55 @@
+#include <limits.h>
+
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_cdf.h>
 
 #include "rvg/generate.h"
 #include "rvg/discrete.h"
 
+// EXAMPLE 1: Gaussian distribution from the GNU library (continuous).
+MAKE_CDF_P(gaussian_cdf, gsl_cdf_gaussian_P, 1)
+MAKE_CDF_Q(gaussian_sf, gsl_cdf_gaussian_Q, 1)
+MAKE_DDF(gaussian_ddf, gaussian_cdf, gaussian_sf)
+
+// EXAMPLE 2: Poisson distribution from the GNU library (discrete), whose
+// mean is passed as the context.
+float poisson_cdf(double x, const void * ctx) {
+    if      (x != x)        { return 1.; }       // nan
+    else if (signbit(x))    { return 0; }        // <= -0.0
+    else if (UINT_MAX < x)  { return 1; }
+    else                    { return gsl_cdf_poisson_P(x, *(const double *) ctx); }
+}
+float poisson_sf(double x, const void * ctx) {
+    if      (x != x)        { return 0; }        // nan
+    else if (signbit(x))    { return 1; }        // <= -0.0
+    else if (UINT_MAX < x)  { return 0; }
+    else                    { return gsl_cdf_poisson_Q(x, *(const double *) ctx); }
+}
+
+// EXAMPLE 3: A custom discrete distribution, whose cumulative probabilities
+// are passed as the context.
+struct custom_discrete {
+    const float * P;
+    size_t K;
+};
+float custom_discrete_cdf(double x, const void * ctx) {
+    const struct custom_discrete * c = ctx;
+    return cdf_discrete(x, c->P, c->K);
+}
+
+// EXAMPLE 4: A custom continuous distribution, F(x) = x^2 over [0,1].
+float custom_continuous_cdf(double x) {
+    if      (x != x)        { return 1.; }       // nan
+    else if (signbit(x))    { return 0; }        // <= -0.0
+    else if (1 <= x)        { return 1; }
+    else                    { return x*x; }
+}
+
+// EXAMPLE 5: A custom CDF that is a point mass at NaN.
+float custom_delta_cdf(double x) {
+    return (x != x) ? 1. : 0.;
+}
+
 int main(int argc, char * argv[]) {
 
     // Prepare the random number generator.
@@ -12,47 +58,37 @@ int main(int argc, char * argv[]) {
 
     double sample;
 
-    // EXAMPLE 1: Gaussian distribution from the GNU library (continuous).
-    MAKE_CDF_P(gaussian_cdf, gsl_cdf_gaussian_P, 1);
-    MAKE_CDF_Q(gaussian_sf, gsl_cdf_gaussian_Q, 1);
-    MAKE_DDF(gaussian_ddf, gaussian_cdf, gaussian_sf);
-
+    // EXAMPLE 1.
     sample = generate_opt(gaussian_cdf, &prng);
     printf("%f\n", sample);
 
     sample = generate_opt_ext(gaussian_ddf, &prng);
     printf("%f\n", sample);
 
-    // EXAMPLE 2: Poisson distribution from the GNU library (discrete).
-    MAKE_CDF_UINT_P(poisson_cdf, gsl_cdf_poisson_P, 5);
-    MAKE_CDF_UINT_Q(poisson_sf, gsl_cdf_poisson_Q, 5);
-    MAKE_DDF(poisson_ddf, poisson_cdf, poisson_sf);
+    // EXAMPLE 2.
+    double mu = 5;
+    struct rvg_ddf poisson_ddf;
+    if (rvg_ddf_make(&poisson_ddf, poisson_cdf, poisson_sf, &mu) != 0) {
+        fprintf(stderr, "Invalid Poisson DDF.\n");
+        return 1;
+    }
 
-    sample = generate_opt(poisson_cdf, &prng);
+    sample = generate_opt_ctx(poisson_cdf, &mu, &prng);
     printf("%f\n", sample);
 
-    sample = generate_opt_ext(poisson_ddf, &prng);
+    sample = generate_opt_ext_ctx(rvg_ddf_eval, &poisson_ddf, &prng);
     printf("%f\n", sample);
 
-    // EXAMPLE 3: A custom discrete distribution.
-    float P[4] = {0.1, 0.3, 0.5, 0.8};
-    MAKE_CDF_UINT_P(custom_discrete_cdf, cdf_discrete, P, 4);
-    sample = generate_opt(custom_discrete_cdf, &prng);
+    // EXAMPLE 3.
+    const float P[4] = {0.1, 0.3, 0.5, 0.8};
+    const struct custom_discrete custom = {P, 4};
+    sample = generate_opt_ctx(custom_discrete_cdf, &custom, &prng);
     printf("%f\n", sample);
 
-    // EXAMPLE 4: A custom continuous distribution, F(x) = x^2 over [0,1].
-    float custom_continuous_cdf(double x) {
-        if      (x != x)        { return 1.; }       // nan
-        else if (signbit(x))    { return 0; }        // <= -0.0
-        else if (1 <= x)        { return 1; }
-        else                    { return x*x; }
-    }
+    // EXAMPLE 4.
     printf("%f\n", generate_opt(custom_continuous_cdf, &prng));
 
-    // EXAMPLE 5: A custom CDF that is a point mass at NaN.
-    float custom_delta_cdf(double x) {
-        return (x != x) ? 1. : 0.;
-    }
+    // EXAMPLE 5.
     printf("%f\n", generate_opt(custom_delta_cdf, &prng));
 
     // Free the random number generator.
@@ -11,6 +11,7 @@
 
 #include "arithmetic.h"
 #include "flip.h"
+#include "prng.h"
 
 const size_t ULLONG_BIT = CHAR_BIT * sizeof(unsigned long long);
 
@@ -23,6 +24,14 @@ int gsl_rng_buffer_size(gsl_rng * rng) {
     return get_buffer_size(M_hi);
 }
 
+// Read words from a GSL generator.
+static void flip_fill_gsl(void * source, unsigned long * words, size_t n) {
+    gsl_rng * rng = source;
+    for (size_t i = 0; i < n; i++) {
+        words[i] = gsl_rng_get(rng);
+    }
+}
+
 struct flip_state make_flip_state(gsl_rng * rng){
     unsigned long M_lo = gsl_rng_min(rng);
     unsigned long M_hi = gsl_rng_max(rng);
@@ -47,48 +56,61 @@ struct flip_state make_flip_state(gsl_rng * rng){
         // E.g., gsl_rng_fishman2x
         assert(0);
     }
+    // Generators in prng.h that produce whole words are read directly. The
+    // words are read ahead only from a counter-based generator: a generic
+    // gsl_rng may be shared with the caller, whose stream would jump ahead,
+    // and the words of an OS-entropy source would be copied into both the
+    // parent and the child of a fork(2).
+    flip_fill_t fill = flip_fill_gsl;
+    void * source = rng;
+    unsigned int num_words = 1;
+    if (rng->type == gsl_rng_philox) {
+        fill = philox_fill;
+        source = rng->state;
+        num_words = FLIP_WORDS;
+    } else if (rng->type == gsl_rng_urandom) {
+        fill = urandom_fill_words;
+    }
+    struct flip_state s = make_flip_state_source(fill, source, buffer_size, num_words);
+    s.rng = rng;
+    return s;
+}
+
+struct flip_state make_flip_state_source(flip_fill_t fill, void * source,
+        unsigned int buffer_size, unsigned int num_words) {
+    assert((0 < buffer_size) && (buffer_size <= ULLONG_BIT));
+    assert((0 < num_words) && (num_words <= FLIP_WORDS));
     struct flip_state s = {
-        .rng = rng,
+        .rng = NULL,
         .buffer_size = buffer_size,
         .flip_pos = buffer_size,
         .num_flips = 0,
+        .fill = fill,
+        .source = source,
+        .word_pos = num_words,
+        .num_words = num_words,
     };
     return s;
 }
 
-unsigned char flip(struct flip_state * state) {
-    if (state->flip_pos == state->buffer_size) {
-        state->buffer = gsl_rng_get(state->rng);
-        state->flip_pos = 0;
+void flip_refill(struct flip_state * state) {
+    if (state->word_pos == state->num_words) {
+        state->fill(state->source, state->words, state->num_words);
+        state->word_pos = 0;
     }
-    unsigned char b = state->buffer & 1;
-    state->buffer >>= 1;
-    state->flip_pos += 1;
-    state->num_flips += 1;
-    return b;
+    state->buffer = state->words[state->word_pos++];
+    state->flip_pos = 0;
 }
 
-unsigned long long flip_k(struct flip_state * state, int k) {
-    if (state->flip_pos == state->buffer_size) {
-        state->buffer = gsl_rng_get(state->rng);
-        state->flip_pos = 0;
-    }
-    unsigned int num_bits_extract = min(k, state->buffer_size - state->flip_pos);
-    // unsigned long long b = state->buffer & ((1ULL << num_bits_extract) - 1ULL);
-    unsigned long long b = state->buffer & (ULLONG_MAX >> (ULLONG_BIT - num_bits_extract));
-    state->buffer >>= num_bits_extract;
-    state->flip_pos += num_bits_extract;
-    state->num_flips += num_bits_extract;
-    return (num_bits_extract == k) ? b :
-        (b << (k - num_bits_extract)) + flip_k(state, k - num_bits_extract);
+void flip_reset(struct flip_state * state) {
+    state->flip_pos = state->buffer_size;
+    state->word_pos = state->num_words;
 }
 
-unsigned long long randint(struct flip_state * state, int k) {
-    unsigned long long n = 0;
-    for (int i = 0; i < k; i++) {
-        int b = flip(state);
-        n <<= 1;
-        n += b;
-    }
-    return n;
-}
+extern inline unsigned char flip(struct flip_state * s);
+extern inline unsigned int flip_avail(struct flip_state * s);
+extern inline void flip_consume(struct flip_state * s, unsigned int k);
+extern inline unsigned long long flip_bits(struct flip_state * s, int k);
+extern inline unsigned long long flip_reverse(unsigned long long x);
+extern inline unsigned long long flip_k(struct flip_state * s, int k);
+extern inline unsigned long long randint(struct flip_state * s, int k);
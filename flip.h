@@ -8,9 +8,28 @@
 #ifndef FLIP_H
 #define FLIP_H
 
+#include <limits.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <gsl/gsl_rng.h>
 
+// Largest number of words obtained from the source per refill.
+#define FLIP_WORDS 16
+
+// Number of bits in unsigned long long, as a constant expression.
+#define FLIP_ULLONG_BIT (CHAR_BIT * sizeof(unsigned long long))
+
+// Counting the bits in `num_flips` is disabled by defining FLIP_NO_COUNT.
+#ifdef FLIP_NO_COUNT
+#define FLIP_COUNT(s, k) ((void) 0)
+#else
+#define FLIP_COUNT(s, k) ((s)->num_flips += (k))
+#endif
+
+// Fill `words` with `n` random words, each with `buffer_size` random bits,
+// from the generator `source`.
+typedef void (*flip_fill_t)(void * source, unsigned long * words, size_t n);
+
 /** A struct that maintains the state of a sequence of flips. */
 struct flip_state {
   gsl_rng * rng;
@@ -18,6 +37,11 @@ struct flip_state {
   unsigned long buffer;
   unsigned int flip_pos;
   unsigned long num_flips;
+  flip_fill_t fill;
+  void * source;
+  unsigned int word_pos;
+  unsigned int num_words;
+  unsigned long words[FLIP_WORDS];
 };
 
 // Number of bits in unsigned long long.
@@ -32,13 +56,119 @@ int gsl_rng_buffer_size(gsl_rng * rng);
 /** Initialize a `flip_state` using an `rng`. */
 struct flip_state make_flip_state(gsl_rng * rng);
 
+/** Initialize a `flip_state` from words of `buffer_size` bits that are
+    produced by `fill` on `source`, `num_words` at a time (at most
+    FLIP_WORDS). A source that is shared with other readers, or that must
+    not repeat its output in a child process after fork(2), should use
+    `num_words` = 1, so that no words are read ahead of the bits. */
+struct flip_state make_flip_state_source(flip_fill_t fill, void * source,
+    unsigned int buffer_size, unsigned int num_words);
+
+// Load the next word into the buffer, refilling the words from the source
+// when they are exhausted.
+void flip_refill(struct flip_state * s);
+
+/** Discard the bits buffered in a `flip_state`. */
+void flip_reset(struct flip_state * s);
+
+// The functions below are inline so that the common case, where the buffer
+// is not empty, compiles to a few instructions at the call site. Each
+// external definition is in flip.c.
+
 /** Generate a single bit from a `flip_state`. */
-unsigned char flip(struct flip_state * s);
+inline unsigned char flip(struct flip_state * s) {
+    if (__builtin_expect(s->flip_pos == s->buffer_size, 0)) {
+        flip_refill(s);
+    }
+    unsigned char b = s->buffer & 1;
+    s->buffer >>= 1;
+    s->flip_pos += 1;
+    FLIP_COUNT(s, 1);
+    return b;
+}
+
+/** Number of bits left in the buffer of a `flip_state`, refilling it
+    first if it is empty. The next bits are the lowest bits of `buffer`. */
+inline unsigned int flip_avail(struct flip_state * s) {
+    if (s->flip_pos == s->buffer_size) {
+        flip_refill(s);
+    }
+    return s->buffer_size - s->flip_pos;
+}
+
+/** Consume the next `k` bits of the buffer, where `k <= flip_avail(s)`. */
+inline void flip_consume(struct flip_state * s, unsigned int k) {
+    s->buffer = (k < FLIP_ULLONG_BIT) ? (s->buffer >> k) : 0;
+    s->flip_pos += k;
+    FLIP_COUNT(s, k);
+}
+
+/** Generate `k` bits from a `flip_state`, with the first bit as the
+    least significant, i.e., bit i of the result is the i-th flip. */
+inline unsigned long long flip_bits(struct flip_state * s, int k) {
+    unsigned long long x = 0;
+    int i = 0;
+    while (i < k) {
+        unsigned int n = flip_avail(s);
+        if ((unsigned int) (k - i) < n) { n = k - i; }
+        unsigned long long b = s->buffer & (ULLONG_MAX >> (FLIP_ULLONG_BIT - n));
+        flip_consume(s, n);
+        x |= b << i;
+        i += n;
+    }
+    return x;
+}
+
+/** Reverse the order of the bits of `x`, so that the next flip in a
+    buffer `x` becomes the most significant bit. */
+inline unsigned long long flip_reverse(unsigned long long x) {
+    x = __builtin_bswap64(x);
+    x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    return x;
+}
 
 /** Generate a random `k`-bit number from a `flip_state`. */
-unsigned long long flip_k(struct flip_state * s, int k);
+inline unsigned long long flip_k(struct flip_state * s, int k) {
+    // The bits of the buffer are consumed least significant first, and each
+    // chunk taken from a buffer forms the next lower bits of the result.
+    unsigned long long x = 0;
+    while (0 < k) {
+        if (s->flip_pos == s->buffer_size) {
+            flip_refill(s);
+        }
+        unsigned int n = s->buffer_size - s->flip_pos;
+        if ((unsigned int) k < n) { n = k; }
+        unsigned long long b = s->buffer & (ULLONG_MAX >> (FLIP_ULLONG_BIT - n));
+        s->buffer = (n < FLIP_ULLONG_BIT) ? (s->buffer >> n) : 0;
+        s->flip_pos += n;
+        FLIP_COUNT(s, n);
+        x = (n < FLIP_ULLONG_BIT) ? ((x << n) | b) : b;
+        k -= n;
+    }
+    return x;
+}
 
 /** Generate a random `k`-bit number from a `flip_state`. */
-unsigned long long randint(struct flip_state * s, int k);
+inline unsigned long long randint(struct flip_state * s, int k) {
+    // As `k` calls to `flip`, with the first bit as the most significant,
+    // which is each chunk of `flip_k` with its bits reversed.
+    unsigned long long x = 0;
+    while (0 < k) {
+        if (s->flip_pos == s->buffer_size) {
+            flip_refill(s);
+        }
+        unsigned int n = s->buffer_size - s->flip_pos;
+        if ((unsigned int) k < n) { n = k; }
+        unsigned long long b = flip_reverse(s->buffer) >> (FLIP_ULLONG_BIT - n);
+        s->buffer = (n < FLIP_ULLONG_BIT) ? (s->buffer >> n) : 0;
+        s->flip_pos += n;
+        FLIP_COUNT(s, n);
+        x = (n < FLIP_ULLONG_BIT) ? ((x << n) | b) : b;
+        k -= n;
+    }
+    return x;
+}
 
 #endif
@@ -7,6 +7,7 @@
 
 #include <assert.h>
 #include <math.h>
+#include <stdlib.h>
 #include <gmp.h>
 
 #include "bits.h"
@@ -14,9 +15,18 @@
 #include "arithmetic.h"
 #include "bernoulli.h"
 #include "generate.h"
+#include "generate_inline.h"
+#include "stats.h"
 
-void cdf64_interval(
-        cdf32_t cdf            // Target CDF.
+// The bodies of the functions below take a target with a context, and are
+// inlined into each public function, as those of generate_inline.h. The
+// functions for a plain cdf32_t or ddf32_t pass it as the context of
+// `cdf_plain` or `ddf_plain`, so that they call the target directly.
+#define GENERATE_INLINE RVG_INLINE
+
+GENERATE_INLINE void cdf64_interval_common(
+        cdf32_ctx_t cdf        // Target CDF.
+        , const void * ctx     // Context of cdf.
         , uint64_t b           // Current bit string (lex order).
         , unsigned int l       // Number of active bits in b, 0 <= l <= 64.
         , float * cdf_l        // Will be set to CDF(b0^m)
@@ -35,21 +45,22 @@ void cdf64_interval(
     uint64_t b_lex = (b << m) + (1ull << m) - 1;        // b+'1'*m
     uint64_t b_flt = bij64_lex2float(b_lex);
     double d = int2double(b_flt);
-    *cdf_r = cdf(d); // TODO if isnan(d) then return 1?
+    *cdf_r = cdf(d, ctx); // TODO if isnan(d) then return 1?
     // Compute CDF at left endpoint.
     if (b > 0) {
         // b has a predecessor.
         b_lex = (b << m) - 1;                           // pred_lex(b+0^m)
         b_flt = bij64_lex2float(b_lex);
         d = int2double(b_flt);
-        *cdf_l = cdf(d);
+        *cdf_l = cdf(d, ctx);
     } else {
         *cdf_l = 0.;
     }
 }
 
-void cdf64_interval_ext(
-        ddf32_t ddf             // Target dual distribution function (DDF).
+GENERATE_INLINE void cdf64_interval_ext_common(
+        ddf32_ctx_t ddf         // Target dual distribution function (DDF).
+        , const void * ctx      // Context of ddf.
         , uint64_t b            // Current bit string (lex order).
         , unsigned int l        // Number of active bits in b, 0 <= l <= 64.
         , bool * d_l            // Will be set to CDF(b0^m)
@@ -70,34 +81,55 @@ void cdf64_interval_ext(
     uint64_t b_lex = (b << m) + (1ull << m) - 1;        // b+'1'*m
     uint64_t b_flt = bij64_lex2float(b_lex);
     double d = int2double(b_flt);
-    ddf(d, d_r, cdf_r); // TODO if isnan(d) then return 1?
+    ddf(d, ctx, d_r, cdf_r); // TODO if isnan(d) then return 1?
     // Compute CDF at left endpoint.
     if (b > 0) {
         // b has a predecessor.
         b_lex = (b << m) - 1;                           // pred_lex(b+0^m)
         b_flt = bij64_lex2float(b_lex);
         d = int2double(b_flt);
-        ddf(d, d_l, cdf_l);
+        ddf(d, ctx, d_l, cdf_l);
     } else {
         *d_l = 0; *cdf_l = 0.;
     }
 }
 
-double generate_cbs(cdf32_t cdf, struct flip_state * prng) {
+void cdf64_interval(cdf32_t cdf, uint64_t b, unsigned int l, float * cdf_l, float * cdf_r) {
+    cdf64_interval_common(cdf_plain, &cdf, b, l, cdf_l, cdf_r);
+}
+
+void cdf64_interval_ext(ddf32_t ddf, uint64_t b, unsigned int l,
+        bool * d_l, float * cdf_l, bool * d_r, float * cdf_r) {
+    cdf64_interval_ext_common(ddf_plain, &ddf, b, l, d_l, cdf_l, d_r, cdf_r);
+}
+
+// Check that the fixed-point difference `w` equals (d0, x) - (d1, y).
+#ifndef NDEBUG
+static void check_fix_gmp(const fix_t w, bool d0, float x, bool d1, float y) {
+    mpq_t op;   mpq_init(op);
+    mpq_t ow;   mpq_init(ow);
+    subtract_gmp_ext(op, d0, x, d1, y);
+    mpz_import(mpq_numref(ow), FIX_WORDS, -1, sizeof(uint64_t), 0, 0, w);
+    mpz_ui_pow_ui(mpq_denref(ow), 2, FIX_BITS - 1);
+    mpq_canonicalize(ow);
+    assert(mpq_equal(op, ow));
+    mpq_clear(op);
+    mpq_clear(ow);
+}
+#endif
+
+GENERATE_INLINE double generate_cbs_common(cdf32_ctx_t cdf, const void * ctx,
+        struct flip_state * prng) {
 
     // Evolving state.
     uint64_t b = 0;
     double cdf_l = 0;
     double cdf_r = 1;
 
-    // GMP objects.
-    mpq_t cdf_w;    mpq_init(cdf_w);    mpq_set_ui(cdf_w, 1, 1);
-    mpq_t cdf_w0;   mpq_init(cdf_w0);
-    mpq_t cdf_w1;   mpq_init(cdf_w1);
-    mpq_t w_sum;    mpq_init(w_sum);
-    mpq_t r;        mpq_init(r);
-    mpz_t k;        mpz_init(k);
-    mpz_t n;        mpz_init(n);
+    // Fixed-point objects.
+    fix_t fix_l, fix_m, fix_r;
+    fix_t cdf_w, cdf_w1;
+    RVG_STATS_BEGIN(prng);
 
     for (int l = 0; l < DBL_SIZE; l++) {
 
@@ -106,7 +138,8 @@ double generate_cbs(cdf32_t cdf, struct flip_state * prng) {
         uint64_t b_lex = (b << (m + 1)) + (1ull << m) - 1;
         uint64_t b_flt = bij64_lex2float(b_lex);
         double d = int2double(b_flt);
-        float cdf_m = cdf(d);
+        float cdf_m = cdf(d, ctx);
+        RVG_STATS_ADD(cdf_calls, 1);
 
         // Compute b+'0' and b+'1'.
         uint64_t b_lex_0 = b << 1;
@@ -116,9 +149,9 @@ double generate_cbs(cdf32_t cdf, struct flip_state * prng) {
         float cdf_check_l, cdf_check_r;
         float cdf_check_l_0, cdf_check_r_0;
         float cdf_check_l_1, cdf_check_r_1;
-        cdf64_interval(cdf, b, l, &cdf_check_l, &cdf_check_r);
-        cdf64_interval(cdf, b_lex_0, l+1, &cdf_check_l_0, &cdf_check_r_0);
-        cdf64_interval(cdf, b_lex_1, l+1, &cdf_check_l_1, &cdf_check_r_1);
+        cdf64_interval_common(cdf, ctx, b, l, &cdf_check_l, &cdf_check_r);
+        cdf64_interval_common(cdf, ctx, b_lex_0, l+1, &cdf_check_l_0, &cdf_check_r_0);
+        cdf64_interval_common(cdf, ctx, b_lex_1, l+1, &cdf_check_l_1, &cdf_check_r_1);
         assert(cdf_check_l == cdf_l);
         assert(cdf_check_r == cdf_r);
         assert(cdf_check_l_0 == cdf_l);
@@ -131,68 +164,66 @@ double generate_cbs(cdf32_t cdf, struct flip_state * prng) {
 
         // Trivial case.
         if (cdf_m == cdf_r) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
             b = b_lex_0;
             cdf_r = cdf_m;
             continue;
         }
         if (cdf_m == cdf_l) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
             b = b_lex_1;
             cdf_l = cdf_m;
             continue;
         }
 
-        // Compute p(b1)/p(b).
-        subtract_gmp(SUB_0, cdf_w1, cdf_r, cdf_m);
-        mpq_div(r, cdf_w1, cdf_w);
-        mpq_get_num(k, r);
-        mpq_get_den(n, r);
+        // Compute p(b1)/p(b), scaled by 2^149 so that both are integers.
+        fix_from_float(cdf_l, fix_l);
+        fix_from_float(cdf_m, fix_m);
+        fix_from_float(cdf_r, fix_r);
+        fix_sub(fix_r, fix_l, cdf_w);
+        fix_sub(fix_r, fix_m, cdf_w1);
 
         #ifndef NDEBUG
-        subtract_gmp(SUB_0, cdf_w0, cdf_m, cdf_l);
-        mpq_add(w_sum, cdf_w0, cdf_w1);
-        assert(mpq_cmp(cdf_w,  w_sum) == 0);
+        check_fix_gmp(cdf_w1, 0, cdf_r, 0, cdf_m);
+        check_fix_gmp(cdf_w, 0, cdf_r, 0, cdf_l);
         #endif
 
-        unsigned char z = bernoulli_gmp(k, n, prng);
+        unsigned char z = bernoulli_fix(cdf_w1, cdf_w, prng);
+        RVG_STATS_LEVEL(RVG_TRACE_SPLIT, l, 0);
         if (z == 0) {
             b = b_lex_0;
             cdf_r = cdf_m;
-            subtract_gmp(SUB_0, cdf_w0, cdf_m, cdf_l);
-            mpq_set(cdf_w, cdf_w0);
         } else {
             b = b_lex_1;
             cdf_l = cdf_m;
-            mpq_set(cdf_w, cdf_w1);
         }
     }
 
-    mpq_clear(cdf_w);
-    mpq_clear(cdf_w0);
-    mpq_clear(cdf_w1);
-    mpq_clear(w_sum);
-    mpq_clear(r);
-    mpz_clear(k);
-    mpz_clear(n);
-
+    RVG_STATS_SAMPLE(prng, DBL_SIZE, 0);
     b = bij64_lex2float(b);
     return int2double(b);
 }
 
-double generate_cbs_ext(ddf32_t ddf, struct flip_state * prng) {
+double generate_cbs(cdf32_t cdf, struct flip_state * prng) {
+    return generate_cbs_common(cdf_plain, &cdf, prng);
+}
+
+double generate_cbs_ctx(cdf32_ctx_t cdf, const void * ctx, struct flip_state * prng) {
+    return generate_cbs_common(cdf, ctx, prng);
+}
+
+GENERATE_INLINE double generate_cbs_ext_common(ddf32_ctx_t ddf, const void * ctx,
+        struct flip_state * prng) {
 
     // Evolving state.
     uint64_t b = 0;
     bool d_l = 0; float cdf_l = 0;
     bool d_r = 1; float cdf_r = 0;
 
-    // GMP objects.
-    mpq_t cdf_w;    mpq_init(cdf_w);    mpq_set_ui(cdf_w, 1, 1);
-    mpq_t cdf_w0;   mpq_init(cdf_w0);
-    mpq_t cdf_w1;   mpq_init(cdf_w1);
-    mpq_t w_sum;    mpq_init(w_sum);
-    mpq_t r;        mpq_init(r);
-    mpz_t k;        mpz_init(k);
-    mpz_t n;        mpz_init(n);
+    // Fixed-point objects.
+    fix_t fix_l, fix_m, fix_r;
+    fix_t cdf_w, cdf_w1;
+    RVG_STATS_BEGIN(prng);
 
     for (int l = 0; l < DBL_SIZE; l++) {
         // Compute CDF at midpoint.
@@ -201,7 +232,8 @@ double generate_cbs_ext(ddf32_t ddf, struct flip_state * prng) {
         uint64_t b_flt = bij64_lex2float(b_lex);
         double d = int2double(b_flt);
         bool d_m; float cdf_m;
-        ddf(d, &d_m, &cdf_m);
+        ddf(d, ctx, &d_m, &cdf_m);
+        RVG_STATS_ADD(cdf_calls, 1);
 
         // Compute b+'0' and b+'1'.
         uint64_t b_lex_0 = b << 1;
@@ -211,9 +243,9 @@ double generate_cbs_ext(ddf32_t ddf, struct flip_state * prng) {
         bool cdf_check_dl, cdf_check_dr;        float cdf_check_l, cdf_check_r;
         bool cdf_check_dl_0, cdf_check_dr_0;    float cdf_check_l_0, cdf_check_r_0;
         bool cdf_check_dl_1, cdf_check_dr_1;    float cdf_check_l_1, cdf_check_r_1;
-        cdf64_interval_ext(ddf, b, l, &cdf_check_dl, &cdf_check_l, &cdf_check_dr, &cdf_check_r);
-        cdf64_interval_ext(ddf, b_lex_0, l+1, &cdf_check_dl_0, &cdf_check_l_0, &cdf_check_dr_0, &cdf_check_r_0);
-        cdf64_interval_ext(ddf, b_lex_1, l+1, &cdf_check_dl_1, &cdf_check_l_1, &cdf_check_dr_1, &cdf_check_r_1);
+        cdf64_interval_ext_common(ddf, ctx, b, l, &cdf_check_dl, &cdf_check_l, &cdf_check_dr, &cdf_check_r);
+        cdf64_interval_ext_common(ddf, ctx, b_lex_0, l+1, &cdf_check_dl_0, &cdf_check_l_0, &cdf_check_dr_0, &cdf_check_r_0);
+        cdf64_interval_ext_common(ddf, ctx, b_lex_1, l+1, &cdf_check_dl_1, &cdf_check_l_1, &cdf_check_dr_1, &cdf_check_r_1);
         assert(cdf_check_dl == d_l);           assert(cdf_check_l == cdf_l);
         assert(cdf_check_dr == d_r);           assert(cdf_check_r == cdf_r);
         assert(cdf_check_dl_0 == d_l);         assert(cdf_check_l_0 == cdf_l);
@@ -228,168 +260,317 @@ double generate_cbs_ext(ddf32_t ddf, struct flip_state * prng) {
 
         // Trivial case.
         if ((d_m == d_r) && (cdf_m == cdf_r)) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
             b = b_lex_0;
             d_r = d_m; cdf_r = cdf_m;
             continue;
         }
         if ((d_m == d_l) && (cdf_m == cdf_l)) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
             b = b_lex_1;
             d_l = d_m; cdf_l = cdf_m;
             continue;
         }
 
-        // Compute p(b1)/p(b)
-        subtract_gmp_ext(cdf_w, d_r, cdf_r, d_l, cdf_l);
-        subtract_gmp_ext(cdf_w1, d_r, cdf_r, d_m, cdf_m);
-        mpq_div(r, cdf_w1, cdf_w);
-        mpq_get_num(k, r);
-        mpq_get_den(n, r);
+        // Compute p(b1)/p(b), scaled by 2^149 so that both are integers.
+        fix_from_ddf(d_l, cdf_l, fix_l);
+        fix_from_ddf(d_m, cdf_m, fix_m);
+        fix_from_ddf(d_r, cdf_r, fix_r);
+        fix_sub(fix_r, fix_l, cdf_w);
+        fix_sub(fix_r, fix_m, cdf_w1);
 
         #ifndef NDEBUG
-        subtract_gmp_ext(cdf_w0, d_m, cdf_m, d_l, cdf_l);
-        mpq_add(w_sum, cdf_w0, cdf_w1);
-        assert(mpq_cmp(cdf_w, w_sum) == 0);
+        check_fix_gmp(cdf_w1, d_r, cdf_r, d_m, cdf_m);
+        check_fix_gmp(cdf_w, d_r, cdf_r, d_l, cdf_l);
         #endif
 
-        unsigned char z = bernoulli_gmp(k, n, prng);
+        unsigned char z = bernoulli_fix(cdf_w1, cdf_w, prng);
+        RVG_STATS_LEVEL(RVG_TRACE_SPLIT, l, 0);
         if (z == 0) {
             b = b_lex_0;
             d_r = d_m; cdf_r = cdf_m;
-            subtract_gmp_ext(cdf_w0, d_m, cdf_m, d_l, cdf_l);
-            mpq_set(cdf_w, cdf_w0);
         } else {
             b = b_lex_1;
             d_l = d_m; cdf_l = cdf_m;
-            mpq_set(cdf_w, cdf_w1);
         }
     }
 
-    mpq_clear(cdf_w);
-    mpq_clear(cdf_w0);
-    mpq_clear(cdf_w1);
-    mpq_clear(w_sum);
-    mpq_clear(r);
-    mpz_clear(k);
-    mpz_clear(n);
-
+    RVG_STATS_SAMPLE(prng, DBL_SIZE, 0);
     b = bij64_lex2float(b);
     return int2double(b);
 }
 
+double generate_cbs_ext(ddf32_t ddf, struct flip_state * prng) {
+    return generate_cbs_ext_common(ddf_plain, &ddf, prng);
+}
+
+double generate_cbs_ext_ctx(ddf32_ctx_t ddf, const void * ctx, struct flip_state * prng) {
+    return generate_cbs_ext_common(ddf, ctx, prng);
+}
+
 // ================ Simulate Opt ================
 
+extern inline unsigned char generate_opt_split(const struct subtract_exact_s * ss0,
+    const struct subtract_exact_s * ss1, unsigned int * ell, struct flip_state * prng);
+
 double generate_opt(cdf32_t cdf, struct flip_state * prng) {
+    return generate_opt_node_common(cdf_plain, &cdf, NULL, 0, 0, 0, 0, 1, prng);
+}
+
+double generate_opt_node(cdf32_t cdf, uint64_t b, unsigned int l, unsigned int ell,
+        float cdf_l, float cdf_r, struct flip_state * prng) {
+    return generate_opt_node_common(cdf_plain, &cdf, NULL, b, l, ell, cdf_l, cdf_r, prng);
+}
+
+double generate_opt_ctx(cdf32_ctx_t cdf, const void * ctx, struct flip_state * prng) {
+    return generate_opt_node_common(cdf, ctx, NULL, 0, 0, 0, 0, 1, prng);
+}
+
+double generate_opt_node_ctx(cdf32_ctx_t cdf, const void * ctx, uint64_t b, unsigned int l,
+        unsigned int ell, float cdf_l, float cdf_r, struct flip_state * prng) {
+    return generate_opt_node_common(cdf, ctx, NULL, b, l, ell, cdf_l, cdf_r, prng);
+}
+
+double generate_opt_ext(ddf32_t ddf, struct flip_state * prng) {
+    return generate_opt_node_ext_common(ddf_plain, &ddf, NULL, 0, 0, 0, 0, 0, 1, 0, prng);
+}
+
+double generate_opt_node_ext(ddf32_t ddf, uint64_t b, unsigned int l, unsigned int ell,
+        bool d_l, float cdf_l, bool d_r, float cdf_r, struct flip_state * prng) {
+    return generate_opt_node_ext_common(ddf_plain, &ddf, NULL, b, l, ell, d_l, cdf_l, d_r, cdf_r, prng);
+}
+
+double generate_opt_ext_ctx(ddf32_ctx_t ddf, const void * ctx, struct flip_state * prng) {
+    return generate_opt_node_ext_common(ddf, ctx, NULL, 0, 0, 0, 0, 0, 1, 0, prng);
+}
+
+double generate_opt_node_ext_ctx(ddf32_ctx_t ddf, const void * ctx, uint64_t b, unsigned int l,
+        unsigned int ell, bool d_l, float cdf_l, bool d_r, float cdf_r, struct flip_state * prng) {
+    return generate_opt_node_ext_common(ddf, ctx, NULL, b, l, ell, d_l, cdf_l, d_r, cdf_r, prng);
+}
+
+// ================ Simulate Opt (Atom Hook) ================
+
+double atom_uint(double x) {
+    if (isnan(x)) { return x; }
+    if (signbit(x) || (x == 0)) { return 0.; }
+    return ceil(x);
+}
+
+double generate_opt_atom(cdf32_t cdf, atom_t atom, struct flip_state * prng) {
+    return generate_opt_node_common(cdf_plain, &cdf, atom, 0, 0, 0, 0, 1, prng);
+}
+
+double generate_opt_atom_ext(ddf32_t ddf, atom_t atom, struct flip_state * prng) {
+    return generate_opt_node_ext_common(ddf_plain, &ddf, atom, 0, 0, 0, 0, 0, 1, 0, prng);
+}
+
+double generate_opt_atom_ctx(cdf32_ctx_t cdf, const void * ctx, atom_t atom,
+        struct flip_state * prng) {
+    return generate_opt_node_common(cdf, ctx, atom, 0, 0, 0, 0, 1, prng);
+}
+
+double generate_opt_atom_ext_ctx(ddf32_ctx_t ddf, const void * ctx, atom_t atom,
+        struct flip_state * prng) {
+    return generate_opt_node_ext_common(ddf, ctx, atom, 0, 0, 0, 0, 0, 1, 0, prng);
+}
+
+// ================ Simulate Opt (Float Output) ================
+
+// The functions below walk the lex tree of the FLT_SIZE-bit floats instead
+// of the doubles, so the leaf f is returned with probability
+// cdf(f) - cdf(pred(f)), where pred(f) is the float before f.
+
+static inline float generate_optf_common(cdf32_ctx_t cdf, const void * ctx,
+        struct flip_state * prng) {
 
     // Evolving state.
-    uint64_t b = 0;
+    uint32_t b = 0;
     unsigned int ell = 0;
     float cdf_l = 0;
     float cdf_r = 1;
 
-    #ifndef NDEBUG
-    mpq_t kn0; mpq_init(kn0);
-    mpq_t kn1; mpq_init(kn1);
-    mpz_t k0; mpz_init(k0);
-    mpz_t n0; mpz_init(n0);
-    mpz_t k1; mpz_init(k1);
-    mpz_t n1; mpz_init(n1);
-    #endif
+    RVG_STATS_BEGIN(prng);
 
-    for (int l = 0; l < DBL_SIZE; l++) {
+    for (unsigned int l = 0; l < FLT_SIZE; l++) {
 
         // Compute CDF at midpoint.
-        unsigned int m = DBL_SIZE - (l + 1);             // m = n_max - (len(b)+1)
-        uint64_t b_lex = (b << (m + 1)) + (1ull << m) - 1; // b+'0' + '1'*m
-        uint64_t b_flt = bij64_lex2float(b_lex);
-        double d = int2double(b_flt);
-        float cdf_m = cdf(d);
-        assert(cdf_l <= cdf_m);
-        assert(cdf_m <= cdf_r);
-
-        // Compute b+'0' and b+'1'.
-        uint64_t b_lex_0 = b << 1;
-        uint64_t b_lex_1 = b_lex_0 | 1;
+        unsigned int m = FLT_SIZE - (l + 1);             // m = n_max - (len(b)+1)
+        uint32_t b_lex = (b << (m + 1)) + (1u << m) - 1;  // b+'0' + '1'*m
+        uint32_t b_flt = bij32_lex2float(b_lex);
+        float f = int2float(b_flt);
+        float cdf_m = cdf(f, ctx);
+        RVG_STATS_ADD(cdf_calls, 1);
 
-        // Trivial case.
-        if (cdf_m == cdf_r) {
-            // return generate_opt(cdf, b_lex_0, l, cdf_l, cdf_m, prng);
-            b = b_lex_0;
+        // Move to b+'0' or b+'1'.
+        if (generate_opt_child(cdf_l, cdf_m, cdf_r, l, &ell, prng) == 0) {
+            b = b << 1;
             cdf_r = cdf_m;
-            continue;
-        }
-        if (cdf_m == cdf_l) {
-            // return generate_opt(cdf, b_lex_1, l, cdf_m, cdf_r, prng);
-            b = b_lex_1;
+        } else {
+            b = (b << 1) | 1;
             cdf_l = cdf_m;
-            continue;
         }
+    }
 
-        // Finite arithmetic case.
-        struct subtract_exact_s ss0, ss1;
-        subtract_exact(SUB_0, cdf_m, cdf_l, &ss0);
-        subtract_exact(SUB_0, cdf_r, cdf_m, &ss1);
+    RVG_STATS_SAMPLE(prng, FLT_SIZE, ell);
+    b = bij32_lex2float(b);
+    return int2float(b);
+}
 
-        #ifndef NDEBUG
-        subtract_gmp(SUB_0, kn0, cdf_m, cdf_l);
-        subtract_gmp(SUB_0, kn1, cdf_r, cdf_m);
-        mpq_get_num(k0, kn0); mpq_get_den(n0, kn0);
-        mpq_get_num(k1, kn1); mpq_get_den(n1, kn1);
-        #endif
+static inline float generate_optf_ext_common(ddf32_ctx_t ddf, const void * ctx,
+        struct flip_state * prng) {
 
-        if (ell > 0) {
-            int a0 = ith_bit_of_exact(&ss0, ell);
-            int a1 = ith_bit_of_exact(&ss1, ell);
-            #ifndef NDEBUG
-            int z0 = ith_bit_of_fraction_gmp(k0, n0, ell);
-            int z1 = ith_bit_of_fraction_gmp(k1, n1, ell);
-            assert((a0 == z0) && (a1 == z1));
-            #endif
-            if ((a0 == 1) && (a1 == 0)) {
-                b = b_lex_0;
-                cdf_r = cdf_m;
-                continue;
-            }
-            if ((a0 == 0) && (a1 == 1)) {
-                b = b_lex_1;
-                cdf_l = cdf_m;
-                continue;
-            }
-        }
+    // Evolving state.
+    uint32_t b = 0;
+    unsigned int ell = 0;
+    bool d_l = 0; float cdf_l = 0;
+    bool d_r = 1; float cdf_r = 0;
 
-        while (1) {
-            ell += 1;
-            int a0 = ith_bit_of_exact(&ss0, ell);
-            int a1 = ith_bit_of_exact(&ss1, ell);
-            #ifndef NDEBUG
-            int z0 = ith_bit_of_fraction_gmp(k0, n0, ell);
-            int z1 = ith_bit_of_fraction_gmp(k1, n1, ell);
-            assert((a0 == z0) && (a1 == z1));
-            #endif
-            unsigned char x = flip(prng);
-            if ((x == 0) && (a0 == 1)) {
-                b = b_lex_0;
-                cdf_r = cdf_m;
-                break;
-            }
-            if ((x == 1) && (a1 == 1)) {
-                b = b_lex_1;
-                cdf_l = cdf_m;
-                break;
-            }
+    RVG_STATS_BEGIN(prng);
+
+    for (unsigned int l = 0; l < FLT_SIZE; l++) {
+
+        // Compute DDF at midpoint.
+        unsigned int m = FLT_SIZE - (l + 1);             // m = n_max - (len(b)+1)
+        uint32_t b_lex = (b << (m + 1)) + (1u << m) - 1;  // b+'0' + '1'*m
+        uint32_t b_flt = bij32_lex2float(b_lex);
+        float f = int2float(b_flt);
+        bool d_m; float cdf_m;
+        ddf(f, ctx, &d_m, &cdf_m);
+        RVG_STATS_ADD(cdf_calls, 1);
+
+        // Move to b+'0' or b+'1'.
+        if (generate_opt_child_ext(d_l, cdf_l, d_m, cdf_m, d_r, cdf_r, l, &ell, prng) == 0) {
+            b = b << 1;
+            d_r = d_m; cdf_r = cdf_m;
+        } else {
+            b = (b << 1) | 1;
+            d_l = d_m; cdf_l = cdf_m;
         }
     }
 
-    b = bij64_lex2float(b);
-    return int2double(b);
+    RVG_STATS_SAMPLE(prng, FLT_SIZE, ell);
+    b = bij32_lex2float(b);
+    return int2float(b);
 }
 
-double generate_opt_ext(ddf32_t ddf, struct flip_state * prng) {
+float generate_optf(cdf32_t cdf, struct flip_state * prng) {
+    return generate_optf_common(cdf_plain, &cdf, prng);
+}
+
+float generate_optf_ext(ddf32_t ddf, struct flip_state * prng) {
+    return generate_optf_ext_common(ddf_plain, &ddf, prng);
+}
+
+float generate_optf_ctx(cdf32_ctx_t cdf, const void * ctx, struct flip_state * prng) {
+    return generate_optf_common(cdf, ctx, prng);
+}
+
+float generate_optf_ext_ctx(ddf32_ctx_t ddf, const void * ctx, struct flip_state * prng) {
+    return generate_optf_ext_common(ddf, ctx, prng);
+}
+
+// ================ Simulate Opt (Unsigned Integers) ================
+
+// The function below walks a tree over the integers 0 <= k < 2^64 instead
+// of the lex tree of doubles. Each node is an interval [lo, hi] of integers,
+// where cdf_l = cdf(lo-1) and cdf_r = cdf(hi). While lo and hi have different
+// bit lengths, the node is split between bit lengths at (2^e - 1) for the
+// middle bit length e, and otherwise it is the aligned interval of all
+// integers with a given bit length, which is split in half. An integer k
+// with bit length e is therefore reached in at most 7 + (e - 1) levels.
+
+// Number of bits needed to represent `x`.
+static inline unsigned int bit_length(uint64_t x) {
+    return (x == 0) ? 0 : 64 - __builtin_clzll(x);
+}
+
+static inline float cdf_uint_plain(uint64_t k, const void * ctx) {
+    return (*(const cdf_uint_t *) ctx)(k);
+}
+
+static inline uint64_t generate_opt_uint_common(cdf_uint_ctx_t cdf, const void * ctx,
+        struct flip_state * prng) {
 
     // Evolving state.
-    uint64_t b = 0;
+    uint64_t lo = 0;
+    uint64_t hi = UINT64_MAX;
+    unsigned int l = 0;
     unsigned int ell = 0;
-    bool d_l = 0; float cdf_l = 0;
-    bool d_r = 1; float cdf_r = 0;
+    float cdf_l = 0;
+    float cdf_r = 1;
+
+    RVG_STATS_BEGIN(prng);
+
+    for (; lo < hi; l++) {
+
+        // Compute CDF at split point, which is the last integer of the left child.
+        unsigned int e_lo = bit_length(lo);
+        unsigned int e_hi = bit_length(hi);
+        uint64_t x = (e_lo < e_hi)
+            ? (1ull << ((e_lo + e_hi) / 2)) - 1
+            : lo + (hi - lo) / 2;
+        assert((lo <= x) && (x < hi));
+        float cdf_m = cdf(x, ctx);
+        RVG_STATS_ADD(cdf_calls, 1);
+
+        // Move to [lo, x] or [x + 1, hi].
+        if (generate_opt_child(cdf_l, cdf_m, cdf_r, l, &ell, prng) == 0) {
+            hi = x;
+            cdf_r = cdf_m;
+        } else {
+            lo = x + 1;
+            cdf_l = cdf_m;
+        }
+    }
+
+    RVG_STATS_SAMPLE(prng, l, ell);
+    return lo;
+}
+
+uint64_t generate_opt_uint(cdf_uint_t cdf, struct flip_state * prng) {
+    return generate_opt_uint_common(cdf_uint_plain, &cdf, prng);
+}
+
+uint64_t generate_opt_uint_ctx(cdf_uint_ctx_t cdf, const void * ctx, struct flip_state * prng) {
+    return generate_opt_uint_common(cdf, ctx, prng);
+}
+
+// ================ Simulate Opt (Double Precision) ================
+
+// The functions below are those of `generate_opt` for a target whose
+// values are doubles, where the mass of each child is decomposed exactly by
+// `subtract_exact64`.
+
+GENERATE_OPT_SPLIT(generate_opt_split64, struct subtract_exact64_s,
+    ith_bit_of_exact64, window_of_exact64)
+
+// As `generate_opt_child`, for the double-precision CDF values.
+static inline unsigned char generate_opt_child64(
+        double cdf_l
+        , double cdf_m
+        , double cdf_r
+        , unsigned int l
+        , unsigned int * ell
+        , struct flip_state * prng
+        ) {
+    assert(cdf_l <= cdf_m);
+    assert(cdf_m <= cdf_r);
+
+    // Trivial case.
+    if (cdf_m == cdf_r) {
+        RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, *ell);
+        return 0;
+    }
+    if (cdf_m == cdf_l) {
+        RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, *ell);
+        return 1;
+    }
+
+    // Finite arithmetic case.
+    struct subtract_exact64_s ss0, ss1;
+    subtract_exact64(SUB_0, cdf_m, cdf_l, &ss0);
+    subtract_exact64(SUB_0, cdf_r, cdf_m, &ss1);
 
     #ifndef NDEBUG
     mpq_t kn0; mpq_init(kn0);
@@ -398,112 +579,261 @@ double generate_opt_ext(ddf32_t ddf, struct flip_state * prng) {
     mpz_t n0; mpz_init(n0);
     mpz_t k1; mpz_init(k1);
     mpz_t n1; mpz_init(n1);
+    subtract_gmp(SUB_0, kn0, cdf_m, cdf_l);
+    subtract_gmp(SUB_0, kn1, cdf_r, cdf_m);
+    mpq_get_num(k0, kn0); mpq_get_den(n0, kn0);
+    mpq_get_num(k1, kn1); mpq_get_den(n1, kn1);
+    unsigned int ell_0 = *ell;
     #endif
 
-    for (int l = 0; l < DBL_SIZE; l++) {
+    unsigned char z = generate_opt_split64(&ss0, &ss1, ell, prng);
+    RVG_STATS_LEVEL(RVG_TRACE_SPLIT, l, *ell);
+
+    #ifndef NDEBUG
+    for (unsigned int i = (ell_0 > 0) ? ell_0 : 1; i <= *ell; i++) {
+        assert(ith_bit_of_exact64(&ss0, i) == ith_bit_of_fraction_gmp(k0, n0, i));
+        assert(ith_bit_of_exact64(&ss1, i) == ith_bit_of_fraction_gmp(k1, n1, i));
+    }
+    mpq_clear(kn0); mpq_clear(kn1);
+    mpz_clear(k0); mpz_clear(n0);
+    mpz_clear(k1); mpz_clear(n1);
+    #endif
+
+    return z;
+}
+
+// As `generate_opt_child_ext`, for the double-precision DDF values.
+static inline unsigned char generate_opt_child64_ext(
+        bool d_l, double cdf_l
+        , bool d_m, double cdf_m
+        , bool d_r, double cdf_r
+        , unsigned int l
+        , unsigned int * ell
+        , struct flip_state * prng
+        ) {
+    assert(compare_lte_ext64(d_l, cdf_l, d_m, cdf_m));
+    assert(compare_lte_ext64(d_m, cdf_m, d_r, cdf_r));
+
+    // Trivial case.
+    if ((d_m == d_r) && (cdf_m == cdf_r)) {
+        RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, *ell);
+        return 0;
+    }
+    if ((d_m == d_l) && (cdf_m == cdf_l)) {
+        RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, *ell);
+        return 1;
+    }
+
+    // Finite arithmetic case.
+    struct subtract_exact64_s ss0, ss1;
+    subtract_exact64_ext(d_m, cdf_m, d_l, cdf_l, &ss0);
+    subtract_exact64_ext(d_r, cdf_r, d_m, cdf_m, &ss1);
+
+    #ifndef NDEBUG
+    mpq_t kn0; mpq_init(kn0);
+    mpq_t kn1; mpq_init(kn1);
+    mpz_t k0; mpz_init(k0);
+    mpz_t n0; mpz_init(n0);
+    mpz_t k1; mpz_init(k1);
+    mpz_t n1; mpz_init(n1);
+    subtract_gmp_ext(kn0, d_m, cdf_m, d_l, cdf_l);
+    subtract_gmp_ext(kn1, d_r, cdf_r, d_m, cdf_m);
+    mpq_get_num(k0, kn0); mpq_get_den(n0, kn0);
+    mpq_get_num(k1, kn1); mpq_get_den(n1, kn1);
+    unsigned int ell_0 = *ell;
+    #endif
+
+    unsigned char z = generate_opt_split64(&ss0, &ss1, ell, prng);
+    RVG_STATS_LEVEL(RVG_TRACE_SPLIT, l, *ell);
+
+    #ifndef NDEBUG
+    for (unsigned int i = (ell_0 > 0) ? ell_0 : 1; i <= *ell; i++) {
+        assert(ith_bit_of_exact64(&ss0, i) == ith_bit_of_fraction_gmp(k0, n0, i));
+        assert(ith_bit_of_exact64(&ss1, i) == ith_bit_of_fraction_gmp(k1, n1, i));
+    }
+    mpq_clear(kn0); mpq_clear(kn1);
+    mpz_clear(k0); mpz_clear(n0);
+    mpz_clear(k1); mpz_clear(n1);
+    #endif
+
+    return z;
+}
+
+static inline double cdf64_plain(double x, const void * ctx) {
+    return (*(const cdf64_t *) ctx)(x);
+}
+
+static inline void ddf64_plain(double x, const void * ctx, bool * d, double * q) {
+    (*(const ddf64_t *) ctx)(x, d, q);
+}
+
+static inline double generate_opt64_common(cdf64_ctx_t cdf, const void * ctx,
+        struct flip_state * prng) {
+
+    // Evolving state.
+    uint64_t b = 0;
+    unsigned int ell = 0;
+    double cdf_l = 0;
+    double cdf_r = 1;
+
+    RVG_STATS_BEGIN(prng);
+
+    for (unsigned int l = 0; l < DBL_SIZE; l++) {
 
         // Compute CDF at midpoint.
         unsigned int m = DBL_SIZE - (l + 1);             // m = n_max - (len(b)+1)
         uint64_t b_lex = (b << (m + 1)) + (1ull << m) - 1; // b+'0' + '1'*m
         uint64_t b_flt = bij64_lex2float(b_lex);
         double d = int2double(b_flt);
-        bool d_m; float cdf_m;
-        ddf(d, &d_m, &cdf_m);
-        assert(compare_lte_ext(d_l, cdf_l, d_m, cdf_m));
-        assert(compare_lte_ext(d_m, cdf_m, d_r, cdf_r));
-
-        // Compute b+'0' and b+'1'.
-        uint64_t b_lex_0 = b << 1;
-        uint64_t b_lex_1 = b_lex_0 | 1;
+        double cdf_m = cdf(d, ctx);
+        RVG_STATS_ADD(cdf_calls, 1);
 
-        // Trivial case.
-        if ((d_m == d_r) && (cdf_m == cdf_r)) {
-            // return generate_opt_ext(cdf, b_lex_0, l, d_l, cdf_l, d_m, cdf_m, prng);
-            b = b_lex_0;
-            d_r = d_m; cdf_r = cdf_m;
-            continue;
-        }
-        if ((d_m == d_l) && (cdf_m == cdf_l)) {
-            // return generate_opt_ext(cdf, b_lex_1, l, d_m, cdf_m, d_r, cdf_r, prng);
-            b = b_lex_1;
-            d_l = d_m; cdf_l = cdf_m;
-            continue;
+        // Move to b+'0' or b+'1'.
+        if (generate_opt_child64(cdf_l, cdf_m, cdf_r, l, &ell, prng) == 0) {
+            b = b << 1;
+            cdf_r = cdf_m;
+        } else {
+            b = (b << 1) | 1;
+            cdf_l = cdf_m;
         }
+    }
 
-        // Finite arithmetic case.
-        struct subtract_exact_s ss0, ss1;
-        subtract_exact_ext(d_m, cdf_m, d_l, cdf_l, &ss0);
-        subtract_exact_ext(d_r, cdf_r, d_m, cdf_m, &ss1);
+    RVG_STATS_SAMPLE(prng, DBL_SIZE, ell);
+    b = bij64_lex2float(b);
+    return int2double(b);
+}
 
-        #ifndef NDEBUG
-        subtract_gmp_ext(kn0, d_m, cdf_m, d_l, cdf_l);
-        subtract_gmp_ext(kn1, d_r, cdf_r, d_m, cdf_m);
-        mpq_get_num(k0, kn0); mpq_get_den(n0, kn0);
-        mpq_get_num(k1, kn1); mpq_get_den(n1, kn1);
-        #endif
+static inline double generate_opt64_ext_common(ddf64_ctx_t ddf, const void * ctx,
+        struct flip_state * prng) {
 
-        if (ell > 0) {
-            int a0 = ith_bit_of_exact(&ss0, ell);
-            int a1 = ith_bit_of_exact(&ss1, ell);
-            #ifndef NDEBUG
-            int z0 = ith_bit_of_fraction_gmp(k0, n0, ell);
-            int z1 = ith_bit_of_fraction_gmp(k1, n1, ell);
-            assert((a0 == z0) && (a1 == z1));
-            #endif
-            if ((a0 == 1) && (a1 == 0)) {
-                b = b_lex_0;
-                d_r = d_m; cdf_r = cdf_m;
-                continue;
-            }
-            if ((a0 == 0) && (a1 == 1)) {
-                b = b_lex_1;
-                d_l = d_m; cdf_l = cdf_m;
-                continue;
-            }
-        }
+    // Evolving state.
+    uint64_t b = 0;
+    unsigned int ell = 0;
+    bool d_l = 0; double cdf_l = 0;
+    bool d_r = 1; double cdf_r = 0;
 
-        while (1) {
-            ell += 1;
-            int a0 = ith_bit_of_exact(&ss0, ell);
-            int a1 = ith_bit_of_exact(&ss1, ell);
-            #ifndef NDEBUG
-            int z0 = ith_bit_of_fraction_gmp(k0, n0, ell);
-            int z1 = ith_bit_of_fraction_gmp(k1, n1, ell);
-            assert((a0 == z0) && (a1 == z1));
-            #endif
-            unsigned char x = flip(prng);
-            if ((x == 0) && (a0 == 1)) {
-                b = b_lex_0;
-                d_r = d_m; cdf_r = cdf_m;
-                break;
-            }
-            if ((x == 1) && (a1 == 1)) {
-                b = b_lex_1;
-                d_l = d_m; cdf_l = cdf_m;
-                break;
-            }
+    RVG_STATS_BEGIN(prng);
+
+    for (unsigned int l = 0; l < DBL_SIZE; l++) {
+
+        // Compute DDF at midpoint.
+        unsigned int m = DBL_SIZE - (l + 1);             // m = n_max - (len(b)+1)
+        uint64_t b_lex = (b << (m + 1)) + (1ull << m) - 1; // b+'0' + '1'*m
+        uint64_t b_flt = bij64_lex2float(b_lex);
+        double d = int2double(b_flt);
+        bool d_m; double cdf_m;
+        ddf(d, ctx, &d_m, &cdf_m);
+        RVG_STATS_ADD(cdf_calls, 1);
+
+        // Move to b+'0' or b+'1'.
+        if (generate_opt_child64_ext(d_l, cdf_l, d_m, cdf_m, d_r, cdf_r, l, &ell, prng) == 0) {
+            b = b << 1;
+            d_r = d_m; cdf_r = cdf_m;
+        } else {
+            b = (b << 1) | 1;
+            d_l = d_m; cdf_l = cdf_m;
         }
     }
 
+    RVG_STATS_SAMPLE(prng, DBL_SIZE, ell);
     b = bij64_lex2float(b);
     return int2double(b);
 }
 
+double generate_opt64(cdf64_t cdf, struct flip_state * prng) {
+    return generate_opt64_common(cdf64_plain, &cdf, prng);
+}
+
+double generate_opt64_ext(ddf64_t ddf, struct flip_state * prng) {
+    return generate_opt64_ext_common(ddf64_plain, &ddf, prng);
+}
+
+double generate_opt64_ctx(cdf64_ctx_t cdf, const void * ctx, struct flip_state * prng) {
+    return generate_opt64_common(cdf, ctx, prng);
+}
+
+double generate_opt64_ext_ctx(ddf64_ctx_t ddf, const void * ctx, struct flip_state * prng) {
+    return generate_opt64_ext_common(ddf, ctx, prng);
+}
+
 // ================ Quantile Function ================
 
+// Kind of target whose quantile is computed.
+enum quantile_mode {QUANTILE_CDF, QUANTILE_SF, QUANTILE_EXT};
+
+// Whether the query (d, q) of the target in `mode` is at most its value
+// (d_mid, cdf_mid) at the midpoint of a node, i.e., whether the quantile
+// lies in the left half of the node.
+static inline bool quantile_left(enum quantile_mode mode, bool d, float q,
+        bool d_mid, float cdf_mid) {
+    switch (mode) {
+        case QUANTILE_CDF:  return q <= cdf_mid;
+        case QUANTILE_SF:   return cdf_mid < q;
+        default:            return compare_lte_ext(d, q, d_mid, cdf_mid);
+    }
+}
+
+// As `quantile_left`, for a double-precision target.
+static inline bool quantile64_left(enum quantile_mode mode, bool d, double q,
+        bool d_mid, double cdf_mid) {
+    switch (mode) {
+        case QUANTILE_CDF:  return q <= cdf_mid;
+        case QUANTILE_SF:   return cdf_mid < q;
+        default:            return compare_lte_ext64(d, q, d_mid, cdf_mid);
+    }
+}
+
 double quantile(cdf32_t cdf, float q) {
-    assert((0 <= q) && (q <= 1));
-    uint64_t lo = 0;
-    uint64_t hi = 0xffffffffffffffff;
-    union double_bits mid;
-    double x;
+    return quantile_common(cdf_plain, &cdf, q);
+}
+
+double quantile_ctx(cdf32_ctx_t cdf, const void * ctx, float q) {
+    return quantile_common(cdf, ctx, q);
+}
+
+double quantile_sf(cdf32_t sf, float q) {
+    return quantile_sf_common(cdf_plain, &sf, q);
+}
+
+double quantile_sf_ctx(cdf32_ctx_t sf, const void * ctx, float q) {
+    return quantile_sf_common(sf, ctx, q);
+}
+
+double quantile_ext(ddf32_t ddf, bool d, float q) {
+    return quantile_ext_common(ddf_plain, &ddf, d, q);
+}
+
+double quantile_ext_ctx(ddf32_ctx_t ddf, const void * ctx, bool d, float q) {
+    return quantile_ext_common(ddf, ctx, d, q);
+}
+
+// Body of `quantilef`, `quantilef_sf`, and `quantilef_ext`, which bisect
+// the lex tree of floats for the least f at which the target reaches the
+// query, as `quantile` does for the doubles.
+static inline float quantilef_common(
+        enum quantile_mode mode
+        , cdf32_ctx_t cdf       // Target CDF or SF (NULL if ddf is used).
+        , ddf32_ctx_t ddf       // Target DDF (NULL if cdf is used).
+        , const void * ctx      // Context of cdf or ddf.
+        , bool d
+        , float q
+        ) {
+    uint32_t lo = 0;
+    uint32_t hi = 0xffffffff;
+    union float_bits mid;
+    bool d_mid = 0; float cdf_mid;
+    float x = NAN;
     int iter = 0;
     while (1) {
         iter++;
-        uint64_t m = lo/2 + hi/2;
-        mid.i = bij64_lex2float(m);
-        float cdf_mid = cdf(mid.f);
-        if (q <= cdf_mid) {
+        uint32_t m = lo/2 + hi/2;
+        mid.i = bij32_lex2float(m);
+        if (mode == QUANTILE_EXT) {
+            ddf(mid.f, ctx, &d_mid, &cdf_mid);
+        } else {
+            cdf_mid = cdf(mid.f, ctx);
+        }
+        if (quantile_left(mode, d, q, d_mid, cdf_mid)) {
             x = mid.f;
             if (hi == lo) { break; }
             hi = m - 1;
@@ -512,23 +842,62 @@ double quantile(cdf32_t cdf, float q) {
             lo = m + 1;
         }
     }
-    assert(iter == 64);
+    assert(iter == 32);
     return x;
 }
 
-double quantile_sf(cdf32_t sf, float q) {
+float quantilef(cdf32_t cdf, float q) {
+    return quantilef_ctx(cdf_plain, &cdf, q);
+}
+
+float quantilef_sf(cdf32_t sf, float q) {
+    return quantilef_sf_ctx(cdf_plain, &sf, q);
+}
+
+float quantilef_ext(ddf32_t ddf, bool d, float q) {
+    return quantilef_ext_ctx(ddf_plain, &ddf, d, q);
+}
+
+float quantilef_ctx(cdf32_ctx_t cdf, const void * ctx, float q) {
+    assert((0 <= q) && (q <= 1));
+    return quantilef_common(QUANTILE_CDF, cdf, NULL, ctx, 0, q);
+}
+
+float quantilef_sf_ctx(cdf32_ctx_t sf, const void * ctx, float q) {
     assert((0 < q) && (q <= 1));
+    return quantilef_common(QUANTILE_SF, sf, NULL, ctx, 0, q);
+}
+
+float quantilef_ext_ctx(ddf32_ctx_t ddf, const void * ctx, bool d, float q) {
+    assert(check_ddf_val(d, q));
+    return quantilef_common(QUANTILE_EXT, NULL, ddf, ctx, d, q);
+}
+
+// As `quantilef_common`, over the lex tree of doubles for a double-precision target.
+static inline double quantile64_common(
+        enum quantile_mode mode
+        , cdf64_ctx_t cdf       // Target CDF or SF (NULL if ddf is used).
+        , ddf64_ctx_t ddf       // Target DDF (NULL if cdf is used).
+        , const void * ctx      // Context of cdf or ddf.
+        , bool d
+        , double q
+        ) {
     uint64_t lo = 0;
     uint64_t hi = 0xffffffffffffffff;
     union double_bits mid;
-    double x;
+    bool d_mid = 0; double cdf_mid;
+    double x = NAN;
     int iter = 0;
     while (1) {
         iter++;
         uint64_t m = lo/2 + hi/2;
         mid.i = bij64_lex2float(m);
-        float sf_mid = sf(mid.f);
-        if (sf_mid < q) {
+        if (mode == QUANTILE_EXT) {
+            ddf(mid.f, ctx, &d_mid, &cdf_mid);
+        } else {
+            cdf_mid = cdf(mid.f, ctx);
+        }
+        if (quantile64_left(mode, d, q, d_mid, cdf_mid)) {
             x = mid.f;
             if (hi == lo) { break; }
             hi = m - 1;
@@ -541,30 +910,203 @@ double quantile_sf(cdf32_t sf, float q) {
     return x;
 }
 
-double quantile_ext(ddf32_t ddf, bool d, float q) {
-    assert(check_ddf_val(d, q));
-    uint64_t lo = 0;
-    uint64_t hi = 0xffffffffffffffff;
-    union double_bits mid;
-    bool d_mid; float cdf_mid;
-    double x;
-    int iter = 0;
-    while (1) {
-        iter++;
+double quantile64(cdf64_t cdf, double q) {
+    return quantile64_ctx(cdf64_plain, &cdf, q);
+}
+
+double quantile64_sf(cdf64_t sf, double q) {
+    return quantile64_sf_ctx(cdf64_plain, &sf, q);
+}
+
+double quantile64_ext(ddf64_t ddf, bool d, double q) {
+    return quantile64_ext_ctx(ddf64_plain, &ddf, d, q);
+}
+
+double quantile64_ctx(cdf64_ctx_t cdf, const void * ctx, double q) {
+    assert((0 <= q) && (q <= 1));
+    return quantile64_common(QUANTILE_CDF, cdf, NULL, ctx, 0, q);
+}
+
+double quantile64_sf_ctx(cdf64_ctx_t sf, const void * ctx, double q) {
+    assert((0 < q) && (q <= 1));
+    return quantile64_common(QUANTILE_SF, sf, NULL, ctx, 0, q);
+}
+
+double quantile64_ext_ctx(ddf64_ctx_t ddf, const void * ctx, bool d, double q) {
+    assert(check_ddf64_val(d, q));
+    return quantile64_common(QUANTILE_EXT, NULL, ddf, ctx, d, q);
+}
+
+void bounds_quantile64(cdf64_t cdf, double * xlo, double * xhi){
+    bounds_quantile64_ctx(cdf64_plain, &cdf, xlo, xhi);
+}
+
+void bounds_quantile64_sf(cdf64_t sf, double * xlo, double * xhi){
+    bounds_quantile64_sf_ctx(cdf64_plain, &sf, xlo, xhi);
+}
+
+void bounds_quantile64_ext(ddf64_t ddf, double * xlo, double * xhi) {
+    bounds_quantile64_ext_ctx(ddf64_plain, &ddf, xlo, xhi);
+}
+
+void bounds_quantile64_ctx(cdf64_ctx_t cdf, const void * ctx, double * xlo, double * xhi){
+    *xlo = quantile64_ctx(cdf, ctx, nextafter(0, 1.));
+    *xhi = quantile64_ctx(cdf, ctx, 1);
+}
+
+void bounds_quantile64_sf_ctx(cdf64_ctx_t sf, const void * ctx, double * xlo, double * xhi){
+    *xlo = quantile64_sf_ctx(sf, ctx, 1);
+    *xhi = quantile64_sf_ctx(sf, ctx, nextafter(0, 1.));
+}
+
+void bounds_quantile64_ext_ctx(ddf64_ctx_t ddf, const void * ctx, double * xlo, double * xhi) {
+    *xlo = quantile64_ext_ctx(ddf, ctx, 0, nextafter(0, 1.));
+    *xhi = quantile64_ext_ctx(ddf, ctx, 1, 0);
+}
+
+// ================ Batch Quantile Function ================
+
+// The queries are sorted so that, at every node of the bisection in
+// `quantile`, those that move to the left half form a prefix. Each node
+// evaluates the target once and splits the queries by binary search, so a
+// CDF value is computed once no matter how many queries share the node.
+
+struct quantile_key {
+    bool d;
+    float q;
+    size_t i;
+};
+
+static int quantile_cmp_cdf(const void * a, const void * b) {
+    float qa = ((const struct quantile_key *) a)->q;
+    float qb = ((const struct quantile_key *) b)->q;
+    return (qa > qb) - (qa < qb);
+}
+
+static int quantile_cmp_sf(const void * a, const void * b) {
+    return quantile_cmp_cdf(b, a);
+}
+
+static int quantile_cmp_ext(const void * a, const void * b) {
+    const struct quantile_key * ka = a;
+    const struct quantile_key * kb = b;
+    bool ab = compare_lte_ext(ka->d, ka->q, kb->d, kb->q);
+    bool ba = compare_lte_ext(kb->d, kb->q, ka->d, ka->q);
+    return ba - ab;
+}
+
+struct quantile_many_s {
+    enum quantile_mode mode;
+    cdf32_ctx_t cdf;
+    ddf32_ctx_t ddf;
+    const void * ctx;
+    struct quantile_key * keys;
+    double * x;
+};
+
+static void quantile_many_node(
+        struct quantile_many_s * s
+        , uint64_t lo
+        , uint64_t hi
+        , double x
+        , size_t i
+        , size_t j
+        ) {
+    while (i < j) {
         uint64_t m = lo/2 + hi/2;
-        mid.i = bij64_lex2float(m);
-        ddf(mid.f, &d_mid, &cdf_mid);
-        if (compare_lte_ext(d, q, d_mid, cdf_mid)) {
-            x = mid.f;
-            if (hi == lo) { break; }
-            hi = m - 1;
+        union double_bits mid = {.i = bij64_lex2float(m)};
+        bool d_mid = 0; float cdf_mid;
+        if (s->mode == QUANTILE_EXT) {
+            s->ddf(mid.f, s->ctx, &d_mid, &cdf_mid);
         } else {
-            if (lo == hi) { break; }
-            lo = m + 1;
+            cdf_mid = s->cdf(mid.f, s->ctx);
+        }
+        // Queries [i, k) move left and [k, j) move right.
+        size_t k_lo = i;
+        size_t k_hi = j;
+        while (k_lo < k_hi) {
+            size_t k = k_lo + (k_hi - k_lo) / 2;
+            if (quantile_left(s->mode, s->keys[k].d, s->keys[k].q, d_mid, cdf_mid)) {
+                k_lo = k + 1;
+            } else {
+                k_hi = k;
+            }
+        }
+        if (hi == lo) {
+            for (size_t k = i; k < k_lo; k++) { s->x[s->keys[k].i] = mid.f; }
+            for (size_t k = k_lo; k < j; k++) { s->x[s->keys[k].i] = x; }
+            return;
         }
+        quantile_many_node(s, lo, m - 1, mid.f, i, k_lo);
+        lo = m + 1;
+        i = k_lo;
     }
-    assert(iter == 64);
-    return x;
+}
+
+static int quantile_many_common(
+        enum quantile_mode mode
+        , cdf32_ctx_t cdf
+        , ddf32_ctx_t ddf
+        , const void * ctx
+        , const bool * d
+        , const float * q
+        , double * x
+        , size_t n
+        ) {
+    if (n == 0) { return 0; }
+    if (SIZE_MAX / sizeof(struct quantile_key) < n) { return -1; }
+    struct quantile_key * keys = malloc(n * sizeof(struct quantile_key));
+    if (keys == NULL) { return -1; }
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = (struct quantile_key){.d = (d != NULL) && d[i], .q = q[i], .i = i};
+    }
+    switch (mode) {
+        case QUANTILE_CDF:  qsort(keys, n, sizeof(*keys), quantile_cmp_cdf); break;
+        case QUANTILE_SF:   qsort(keys, n, sizeof(*keys), quantile_cmp_sf); break;
+        case QUANTILE_EXT:  qsort(keys, n, sizeof(*keys), quantile_cmp_ext); break;
+    }
+    struct quantile_many_s s = {
+        .mode = mode, .cdf = cdf, .ddf = ddf, .ctx = ctx, .keys = keys, .x = x,
+    };
+    quantile_many_node(&s, 0, 0xffffffffffffffff, NAN, 0, n);
+    free(keys);
+    return 0;
+}
+
+int quantile_many(cdf32_t cdf, const float * q, double * x, size_t n) {
+    return quantile_many_ctx(cdf_plain, &cdf, q, x, n);
+}
+
+int quantile_many_sf(cdf32_t sf, const float * q, double * x, size_t n) {
+    return quantile_many_sf_ctx(cdf_plain, &sf, q, x, n);
+}
+
+int quantile_many_ext(ddf32_t ddf, const bool * d, const float * q, double * x, size_t n) {
+    return quantile_many_ext_ctx(ddf_plain, &ddf, d, q, x, n);
+}
+
+int quantile_many_ctx(cdf32_ctx_t cdf, const void * ctx, const float * q, double * x,
+        size_t n) {
+    #ifndef NDEBUG
+    for (size_t i = 0; i < n; i++) { assert((0 <= q[i]) && (q[i] <= 1)); }
+    #endif
+    return quantile_many_common(QUANTILE_CDF, cdf, NULL, ctx, NULL, q, x, n);
+}
+
+int quantile_many_sf_ctx(cdf32_ctx_t sf, const void * ctx, const float * q, double * x,
+        size_t n) {
+    #ifndef NDEBUG
+    for (size_t i = 0; i < n; i++) { assert((0 < q[i]) && (q[i] <= 1)); }
+    #endif
+    return quantile_many_common(QUANTILE_SF, sf, NULL, ctx, NULL, q, x, n);
+}
+
+int quantile_many_ext_ctx(ddf32_ctx_t ddf, const void * ctx, const bool * d,
+        const float * q, double * x, size_t n) {
+    #ifndef NDEBUG
+    for (size_t i = 0; i < n; i++) { assert(check_ddf_val(d[i], q[i])); }
+    #endif
+    return quantile_many_common(QUANTILE_EXT, NULL, ddf, ctx, d, q, x, n);
 }
 
 void bounds_quantile(cdf32_t cdf, double * xlo, double * xhi){
@@ -581,3 +1123,383 @@ void bounds_quantile_ext(ddf32_t ddf, double * xlo, double * xhi) {
     *xlo = quantile_ext(ddf, 0, nextafterf(0, 1.));
     *xhi = quantile_ext(ddf, 1, 0);
 }
+
+void bounds_quantile_ctx(cdf32_ctx_t cdf, const void * ctx, double * xlo, double * xhi){
+    *xlo = quantile_ctx(cdf, ctx, nextafterf(0, 1.));
+    *xhi = quantile_ctx(cdf, ctx, 1);
+}
+
+void bounds_quantile_sf_ctx(cdf32_ctx_t sf, const void * ctx, double * xlo, double * xhi){
+    *xlo = quantile_sf_ctx(sf, ctx, 1);
+    *xhi = quantile_sf_ctx(sf, ctx, nextafterf(0, 1.));
+}
+
+void bounds_quantile_ext_ctx(ddf32_ctx_t ddf, const void * ctx, double * xlo, double * xhi) {
+    *xlo = quantile_ext_ctx(ddf, ctx, 0, nextafterf(0, 1.));
+    *xhi = quantile_ext_ctx(ddf, ctx, 1, 0);
+}
+
+// ================ Runtime DDF ================
+
+// The cutoff of MAKE_DDF, where the checks of the CDF and SF are reported
+// to the caller rather than exiting.
+
+int rvg_ddf_make(struct rvg_ddf * ddf, cdf32_ctx_t cdf, cdf32_ctx_t sf, const void * ctx) {
+    ddf->cdf = cdf;
+    ddf->sf = sf;
+    ddf->ctx = ctx;
+    ddf->cutoff = quantile_ctx(cdf, ctx, nextafterf(.5, 1));
+    ddf->sign = signbit(ddf->cutoff);
+    int err = 0;
+    if (0.5 < cdf(nextafter(ddf->cutoff, -INFINITY), ctx)) {
+        err |= RVG_DDF_INVALID_CDF;
+    }
+    if (0.5 <= sf(ddf->cutoff, ctx)) {
+        err |= RVG_DDF_INVALID_SF;
+    }
+    return err;
+}
+
+int rvg_ddf64_make(struct rvg_ddf64 * ddf, cdf64_ctx_t cdf, cdf64_ctx_t sf, const void * ctx) {
+    ddf->cdf = cdf;
+    ddf->sf = sf;
+    ddf->ctx = ctx;
+    ddf->cutoff = quantile64_ctx(cdf, ctx, nextafter(.5, 1));
+    ddf->sign = signbit(ddf->cutoff);
+    int err = 0;
+    if (0.5 < cdf(nextafter(ddf->cutoff, -INFINITY), ctx)) {
+        err |= RVG_DDF_INVALID_CDF;
+    }
+    if (0.5 <= sf(ddf->cutoff, ctx)) {
+        err |= RVG_DDF_INVALID_SF;
+    }
+    return err;
+}
+
+void rvg_ddf_eval(double x, const void * ddf, bool * d, float * q) {
+    const struct rvg_ddf * f = ddf;
+    if ((x < f->cutoff)
+            || ((x == f->cutoff)
+                && signbit(x)
+                && !(f->sign))) {
+        *d = 0;
+        *q = f->cdf(x, f->ctx);
+    } else {
+        *d = 1;
+        *q = f->sf(x, f->ctx);
+    }
+    assert(check_ddf_val(*d, *q));
+}
+
+void rvg_ddf64_eval(double x, const void * ddf, bool * d, double * q) {
+    const struct rvg_ddf64 * f = ddf;
+    if ((x < f->cutoff)
+            || ((x == f->cutoff)
+                && signbit(x)
+                && !(f->sign))) {
+        *d = 0;
+        *q = f->cdf(x, f->ctx);
+    } else {
+        *d = 1;
+        *q = f->sf(x, f->ctx);
+    }
+    assert(check_ddf64_val(*d, *q));
+}
+
+// ================ Support-Restricted Generation ================
+
+// All atoms lie in the lex interval [xlo, xhi], where the CDF is 0 strictly
+// before xlo and 1 from xhi onward. Every level above the longest common
+// prefix b of lex(xlo) and lex(xhi) is therefore a trivial case, which does
+// not change the depth `ell` of the entropy-optimal tree. Starting at the
+// node b with cdf_l = 0 and cdf_r = 1 thus consumes the same bits and gives
+// the same result as starting at the root.
+
+static struct support_prefix make_support_prefix_common(double xlo, double xhi) {
+    uint64_t lo = bij64_float2lex(double2int(xlo));
+    uint64_t hi = bij64_float2lex(double2int(xhi));
+    assert(lo <= hi);
+    uint64_t diff = lo ^ hi;
+    unsigned int l = (diff == 0) ? DBL_SIZE : __builtin_clzll(diff);
+    uint64_t b = (l == 0) ? 0 : lo >> (DBL_SIZE - l);
+    return (struct support_prefix){.b = b, .l = l};
+}
+
+struct support_prefix make_support_prefix(cdf32_t cdf) {
+    double xlo, xhi;
+    bounds_quantile(cdf, &xlo, &xhi);
+    return make_support_prefix_common(xlo, xhi);
+}
+
+struct support_prefix make_support_prefix_ext(ddf32_t ddf) {
+    double xlo, xhi;
+    bounds_quantile_ext(ddf, &xlo, &xhi);
+    return make_support_prefix_common(xlo, xhi);
+}
+
+double generate_opt_prefix(cdf32_t cdf, const struct support_prefix * prefix,
+        struct flip_state * prng) {
+    return generate_opt_node(cdf, prefix->b, prefix->l, 0, 0, 1, prng);
+}
+
+double generate_opt_prefix_ext(ddf32_t ddf, const struct support_prefix * prefix,
+        struct flip_state * prng) {
+    return generate_opt_node_ext(ddf, prefix->b, prefix->l, 0, 0, 0, 1, 0, prng);
+}
+
+struct support_prefix make_support_prefix_ctx(cdf32_ctx_t cdf, const void * ctx) {
+    double xlo, xhi;
+    bounds_quantile_ctx(cdf, ctx, &xlo, &xhi);
+    return make_support_prefix_common(xlo, xhi);
+}
+
+struct support_prefix make_support_prefix_ext_ctx(ddf32_ctx_t ddf, const void * ctx) {
+    double xlo, xhi;
+    bounds_quantile_ext_ctx(ddf, ctx, &xlo, &xhi);
+    return make_support_prefix_common(xlo, xhi);
+}
+
+double generate_opt_prefix_ctx(cdf32_ctx_t cdf, const void * ctx,
+        const struct support_prefix * prefix, struct flip_state * prng) {
+    return generate_opt_node_ctx(cdf, ctx, prefix->b, prefix->l, 0, 0, 1, prng);
+}
+
+double generate_opt_prefix_ext_ctx(ddf32_ctx_t ddf, const void * ctx,
+        const struct support_prefix * prefix, struct flip_state * prng) {
+    return generate_opt_node_ext_ctx(ddf, ctx, prefix->b, prefix->l, 0, 0, 0, 1, 0, prng);
+}
+
+// ================ Truncated Generation ================
+
+// The target conditioned on a < X <= b has the CDF clamped to [cdf(a),
+// cdf(b)], whose atoms lie in the lex interval [lex(a)+1, lex(b)]. As in
+// `make_support_prefix`, every level above the longest common prefix of the
+// endpoints is a trivial case, so the traversal starts there, and the
+// midpoints that fall outside of the interval are trivial cases that do not
+// call the target. The interval is ordered as the lex indexes, in which
+// -0.0 precedes +0.0, so (-0.0, +0.0] contains +0.0. The node masses sum
+// to cdf(b) - cdf(a) rather than 1, so the children are not chosen by the
+// entropy-optimal tree, whose depth `ell` is only meaningful for a node
+// reached from the root. Each split
+// instead flips a coin with the exact ratio of the mass of the right child
+// to that of the node, as in `generate_cbs`, so the cost does not depend on
+// the mass of the interval, but each split consumes the bits of a CBS coin
+// (e.g., about 44 flips per draw from a standard normal on (-0.3, 0.7],
+// against about 25 for `generate_opt` on the whole normal). An empty
+// interval, with lex(a) >= lex(b) or with zero mass, or a NaN endpoint,
+// gives NaN.
+
+// Longest common prefix of the lex interval (a, b], stored in `b_pre` and `l`.
+// Returns false if either is NaN or the interval is empty (lex(a) >= lex(b)).
+static bool truncated_prefix(double a, double b, uint64_t * lo, uint64_t * hi,
+        uint64_t * b_pre, unsigned int * l) {
+    if (isnan(a) || isnan(b)) { return false; }
+    uint64_t lex_a = bij64_float2lex(double2int(a));
+    uint64_t lex_b = bij64_float2lex(double2int(b));
+    if (!(lex_a < lex_b)) { return false; }
+    *lo = lex_a + 1;
+    *hi = lex_b;
+    assert(0 < *lo);
+    assert(*lo <= *hi);
+    uint64_t diff = *lo ^ *hi;
+    *l = (diff == 0) ? DBL_SIZE : __builtin_clzll(diff);
+    *b_pre = (*l == 0) ? 0 : *lo >> (DBL_SIZE - *l);
+    return true;
+}
+
+static inline double generate_opt_truncated_common(cdf32_ctx_t cdf, const void * ctx,
+        double a, double b, struct flip_state * prng) {
+
+    // Evolving state.
+    uint64_t lo, hi, bb;
+    unsigned int l;
+    if (!truncated_prefix(a, b, &lo, &hi, &bb, &l)) { return NAN; }
+    RVG_STATS_BEGIN(prng);
+    float cdf_l = cdf(a, ctx);
+    float cdf_r = cdf(b, ctx);
+    RVG_STATS_ADD(cdf_calls, 2);
+    assert(cdf_l <= cdf_r);
+    if (cdf_l == cdf_r) { return NAN; }
+
+    // Fixed-point objects.
+    fix_t fix_l, fix_m, fix_r;
+    fix_t cdf_w, cdf_w1;
+
+    for (; l < DBL_SIZE; l++) {
+
+        // Compute b+'0' and b+'1'.
+        uint64_t b_lex_0 = bb << 1;
+        uint64_t b_lex_1 = b_lex_0 | 1;
+
+        // Compute CDF at midpoint, clamped to the interval.
+        unsigned int m = DBL_SIZE - (l + 1);
+        uint64_t b_lex = (bb << (m + 1)) + (1ull << m) - 1;
+        if (b_lex < lo) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
+            bb = b_lex_1;
+            continue;
+        }
+        if (hi <= b_lex) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
+            bb = b_lex_0;
+            continue;
+        }
+        uint64_t b_flt = bij64_lex2float(b_lex);
+        double d = int2double(b_flt);
+        float cdf_m = cdf(d, ctx);
+        RVG_STATS_ADD(cdf_calls, 1);
+        assert(cdf_l <= cdf_m);
+        assert(cdf_m <= cdf_r);
+
+        // Trivial case.
+        if (cdf_m == cdf_r) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
+            bb = b_lex_0;
+            cdf_r = cdf_m;
+            continue;
+        }
+        if (cdf_m == cdf_l) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
+            bb = b_lex_1;
+            cdf_l = cdf_m;
+            continue;
+        }
+
+        // Compute p(b1)/p(b), scaled by 2^149 so that both are integers.
+        fix_from_float(cdf_l, fix_l);
+        fix_from_float(cdf_m, fix_m);
+        fix_from_float(cdf_r, fix_r);
+        fix_sub(fix_r, fix_l, cdf_w);
+        fix_sub(fix_r, fix_m, cdf_w1);
+
+        #ifndef NDEBUG
+        check_fix_gmp(cdf_w1, 0, cdf_r, 0, cdf_m);
+        check_fix_gmp(cdf_w, 0, cdf_r, 0, cdf_l);
+        #endif
+
+        unsigned char z = bernoulli_fix(cdf_w1, cdf_w, prng);
+        RVG_STATS_LEVEL(RVG_TRACE_SPLIT, l, 0);
+        if (z == 0) {
+            bb = b_lex_0;
+            cdf_r = cdf_m;
+        } else {
+            bb = b_lex_1;
+            cdf_l = cdf_m;
+        }
+    }
+
+    assert((lo <= bb) && (bb <= hi));
+    RVG_STATS_SAMPLE(prng, DBL_SIZE, 0);
+    bb = bij64_lex2float(bb);
+    return int2double(bb);
+}
+
+static inline double generate_opt_truncated_ext_common(ddf32_ctx_t ddf, const void * ctx,
+        double a, double b, struct flip_state * prng) {
+
+    // Evolving state.
+    uint64_t lo, hi, bb;
+    unsigned int l;
+    if (!truncated_prefix(a, b, &lo, &hi, &bb, &l)) { return NAN; }
+    RVG_STATS_BEGIN(prng);
+    bool d_l; float cdf_l;
+    bool d_r; float cdf_r;
+    ddf(a, ctx, &d_l, &cdf_l);
+    ddf(b, ctx, &d_r, &cdf_r);
+    RVG_STATS_ADD(cdf_calls, 2);
+    assert(compare_lte_ext(d_l, cdf_l, d_r, cdf_r));
+    if ((d_l == d_r) && (cdf_l == cdf_r)) { return NAN; }
+
+    // Fixed-point objects.
+    fix_t fix_l, fix_m, fix_r;
+    fix_t cdf_w, cdf_w1;
+
+    for (; l < DBL_SIZE; l++) {
+
+        // Compute b+'0' and b+'1'.
+        uint64_t b_lex_0 = bb << 1;
+        uint64_t b_lex_1 = b_lex_0 | 1;
+
+        // Compute DDF at midpoint, clamped to the interval.
+        unsigned int m = DBL_SIZE - (l + 1);
+        uint64_t b_lex = (bb << (m + 1)) + (1ull << m) - 1;
+        if (b_lex < lo) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
+            bb = b_lex_1;
+            continue;
+        }
+        if (hi <= b_lex) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
+            bb = b_lex_0;
+            continue;
+        }
+        uint64_t b_flt = bij64_lex2float(b_lex);
+        double d = int2double(b_flt);
+        bool d_m; float cdf_m;
+        ddf(d, ctx, &d_m, &cdf_m);
+        RVG_STATS_ADD(cdf_calls, 1);
+        assert(compare_lte_ext(d_l, cdf_l, d_m, cdf_m));
+        assert(compare_lte_ext(d_m, cdf_m, d_r, cdf_r));
+
+        // Trivial case.
+        if ((d_m == d_r) && (cdf_m == cdf_r)) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
+            bb = b_lex_0;
+            d_r = d_m; cdf_r = cdf_m;
+            continue;
+        }
+        if ((d_m == d_l) && (cdf_m == cdf_l)) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
+            bb = b_lex_1;
+            d_l = d_m; cdf_l = cdf_m;
+            continue;
+        }
+
+        // Compute p(b1)/p(b), scaled by 2^149 so that both are integers.
+        fix_from_ddf(d_l, cdf_l, fix_l);
+        fix_from_ddf(d_m, cdf_m, fix_m);
+        fix_from_ddf(d_r, cdf_r, fix_r);
+        fix_sub(fix_r, fix_l, cdf_w);
+        fix_sub(fix_r, fix_m, cdf_w1);
+
+        #ifndef NDEBUG
+        check_fix_gmp(cdf_w1, d_r, cdf_r, d_m, cdf_m);
+        check_fix_gmp(cdf_w, d_r, cdf_r, d_l, cdf_l);
+        #endif
+
+        unsigned char z = bernoulli_fix(cdf_w1, cdf_w, prng);
+        RVG_STATS_LEVEL(RVG_TRACE_SPLIT, l, 0);
+        if (z == 0) {
+            bb = b_lex_0;
+            d_r = d_m; cdf_r = cdf_m;
+        } else {
+            bb = b_lex_1;
+            d_l = d_m; cdf_l = cdf_m;
+        }
+    }
+
+    assert((lo <= bb) && (bb <= hi));
+    RVG_STATS_SAMPLE(prng, DBL_SIZE, 0);
+    bb = bij64_lex2float(bb);
+    return int2double(bb);
+}
+
+double generate_opt_truncated(cdf32_t cdf, double a, double b,
+        struct flip_state * prng) {
+    return generate_opt_truncated_common(cdf_plain, &cdf, a, b, prng);
+}
+
+double generate_opt_truncated_ext(ddf32_t ddf, double a, double b,
+        struct flip_state * prng) {
+    return generate_opt_truncated_ext_common(ddf_plain, &ddf, a, b, prng);
+}
+
+double generate_opt_truncated_ctx(cdf32_ctx_t cdf, const void * ctx, double a, double b,
+        struct flip_state * prng) {
+    return generate_opt_truncated_common(cdf, ctx, a, b, prng);
+}
+
+double generate_opt_truncated_ext_ctx(ddf32_ctx_t ddf, const void * ctx, double a, double b,
+        struct flip_state * prng) {
+    return generate_opt_truncated_ext_common(ddf, ctx, a, b, prng);
+}
@@ -9,24 +9,47 @@
 #define GENERATE_H
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 
 #include "arithmetic.h"
 #include "flip.h"
+#include "stats.h"
 
 // 32-bit cumulative distribution functions, returns Pr(X <= x).
-// The 64-bit version is unused.
+// The 64-bit version is used by the functions with a `64` suffix.
 typedef float  (*cdf32_t)(double x);
 typedef double (*cdf64_t)(double x);
 
 // 32-bit dual distribution function. It takes as input a double `x`,
 // pointers to boolean `b` and float `p` that are modified with result.
-// The 64-bit version is unused.
+// The 64-bit version is used by the functions with a `64` suffix.
 typedef void (*ddf32_t)(double x, bool * b, float * p);
 typedef void (*ddf64_t)(double x, bool * b , double * p);
 
+// As cdf32_t and ddf32_t, with a context `ctx` that is passed unchanged to
+// every call, so that one function serves a family of targets (e.g., the
+// parameters of a distribution). They are used by the functions with a
+// `_ctx` suffix, and need no nested functions.
+typedef float (*cdf32_ctx_t)(double x, const void * ctx);
+typedef void (*ddf32_ctx_t)(double x, const void * ctx, bool * b, float * p);
+typedef double (*cdf64_ctx_t)(double x, const void * ctx);
+typedef void (*ddf64_ctx_t)(double x, const void * ctx, bool * b, double * p);
+
+// Returns the least candidate atom that is not less than `x` in lex order
+// (where -0.0 < +0.0), or NaN if there is none. The candidates must include
+// every atom of the target, and a larger set of candidates is allowed.
+typedef double (*atom_t)(double x);
+
+// 32-bit cumulative distribution function over unsigned integers, returns
+// Pr(X <= k). It is used by `generate_opt_uint`.
+typedef float (*cdf_uint_t)(uint64_t k);
+typedef float (*cdf_uint_ctx_t)(uint64_t k, const void * ctx);
+
 // Stores cdf_l = cdf(b^{-}) and cdf_r = cdf(b^{+}), where b indexes a block
 // in a partition of all floating-point numbers. Refer to Section 5.2,
 // Proposition 5.13 of [SL25].
@@ -39,6 +62,73 @@ double generate_opt(cdf32_t cdf, struct flip_state * prng);
 /** Generate random variables optimally from `ddf`. */
 double generate_opt_ext(ddf32_t ddf, struct flip_state * prng);
 
+/** Generate random variables optimally from `cdf` with context `ctx`. */
+double generate_opt_ctx(cdf32_ctx_t cdf, const void * ctx, struct flip_state * prng);
+
+/** Generate random variables optimally from `ddf` with context `ctx`. */
+double generate_opt_ext_ctx(ddf32_ctx_t ddf, const void * ctx, struct flip_state * prng);
+
+// Define `unsigned char name(ss_t * ss0, ss_t * ss1, unsigned int * ell,
+// struct flip_state * prng)`, which chooses the child of a non-trivial node
+// whose children have masses `ss0` and `ss1`, where `ell` is the depth
+// reached so far in the entropy-optimal generation tree, exactly as in
+// `generate_opt`. The bits of the masses are read by `ith_bit` one at a
+// time and by `window` 64 at a time. The flip x at depth ell chooses child 0
+// if x = 0 and the bit a0 at depth ell is 1, or child 1 if x = 1 and a1 is
+// 1. The first flip almost always decides, so it is checked on its own.
+// Otherwise, both conditions are evaluated at all depths covered by the
+// buffered flips at once, and only the flips up to and including the first
+// deciding one are used.
+#define GENERATE_OPT_SPLIT(name, ss_t, ith_bit, window)                       \
+unsigned char name(const ss_t * ss0, const ss_t * ss1, unsigned int * ell,    \
+        struct flip_state * prng) {                                           \
+    if (*ell > 0) {                                                           \
+        int a0 = ith_bit(ss0, *ell);                                          \
+        int a1 = ith_bit(ss1, *ell);                                          \
+        if ((a0 == 1) && (a1 == 0)) { return 0; }                             \
+        if ((a0 == 0) && (a1 == 1)) { return 1; }                             \
+    }                                                                         \
+    *ell += 1;                                                                \
+    int a0 = ith_bit(ss0, *ell);                                              \
+    int a1 = ith_bit(ss1, *ell);                                              \
+    unsigned char x = flip(prng);                                             \
+    if ((x == 0) && (a0 == 1)) { return 0; }                                  \
+    if ((x == 1) && (a1 == 1)) { return 1; }                                  \
+    while (1) {                                                               \
+        RVG_STATS_ADD(windows, 1);                                            \
+        unsigned int avail = flip_avail(prng);                                \
+        uint64_t w0 = window(ss0, *ell + 1);                                  \
+        uint64_t w1 = window(ss1, *ell + 1);                                  \
+        uint64_t y = flip_reverse(prng->buffer);                              \
+        uint64_t z = ((~y & w0) | (y & w1)) & (UINT64_MAX << (64 - avail));   \
+        if (z != 0) {                                                         \
+            unsigned int c = __builtin_clzll(z);                              \
+            flip_consume(prng, c + 1);                                        \
+            *ell += c + 1;                                                    \
+            return (y >> (63 - c)) & 1;                                       \
+        }                                                                     \
+        flip_consume(prng, avail);                                            \
+        *ell += avail;                                                        \
+    }                                                                         \
+}
+
+// The split of `generate_opt`, which is inline so that it is available to
+// generate_inline.h, and whose external definition is in generate.c.
+inline GENERATE_OPT_SPLIT(generate_opt_split, struct subtract_exact_s,
+    ith_bit_of_exact, window_of_exact)
+
+// Resume `generate_opt` at the node `b` with `l` active bits, whose
+// endpoints have CDF values `cdf_l` and `cdf_r`, where `ell` is the depth
+// reached so far in the entropy-optimal generation tree.
+double generate_opt_node(cdf32_t cdf, uint64_t b, unsigned int l, unsigned int ell,
+    float cdf_l, float cdf_r, struct flip_state * prng);
+double generate_opt_node_ext(ddf32_t ddf, uint64_t b, unsigned int l, unsigned int ell,
+    bool d_l, float cdf_l, bool d_r, float cdf_r, struct flip_state * prng);
+double generate_opt_node_ctx(cdf32_ctx_t cdf, const void * ctx, uint64_t b, unsigned int l,
+    unsigned int ell, float cdf_l, float cdf_r, struct flip_state * prng);
+double generate_opt_node_ext_ctx(ddf32_ctx_t ddf, const void * ctx, uint64_t b, unsigned int l,
+    unsigned int ell, bool d_l, float cdf_l, bool d_r, float cdf_r, struct flip_state * prng);
+
 /* Compute the exact `q`-quantile of the `cdf`, where `q` must be in [0,1]. */
 double quantile(cdf32_t cdf, float q);
 
@@ -48,6 +138,39 @@ double quantile_sf(cdf32_t sf, float q);
 /* Compute the exact `q`-quantile of the `ddf`, where `q` must be in [0,1]. */
 double quantile_ext(ddf32_t ddf, bool d, float q);
 
+/* Compute the exact `q`-quantile of the `cdf` with context `ctx`. */
+double quantile_ctx(cdf32_ctx_t cdf, const void * ctx, float q);
+
+/* Compute the exact `q`-quantile of the `sf` with context `ctx`. */
+double quantile_sf_ctx(cdf32_ctx_t sf, const void * ctx, float q);
+
+/* Compute the exact `q`-quantile of the `ddf` with context `ctx`. */
+double quantile_ext_ctx(ddf32_ctx_t ddf, const void * ctx, bool d, float q);
+
+/* Compute the exact quantiles x[i] of `cdf` at q[i], for 0 <= i < n.
+   Returns 0, or -1 if the sorted queries cannot be allocated, in which
+   case `x` is unchanged. */
+int quantile_many(cdf32_t cdf, const float * q, double * x, size_t n);
+
+/* Compute the exact quantiles x[i] of `sf` at q[i], for 0 <= i < n, with
+   the same errors as `quantile_many`. */
+int quantile_many_sf(cdf32_t sf, const float * q, double * x, size_t n);
+
+/* Compute the exact quantiles x[i] of `ddf` at (d[i], q[i]), for 0 <= i < n. */
+int quantile_many_ext(ddf32_t ddf, const bool * d, const float * q, double * x, size_t n);
+
+/* Compute the exact quantiles x[i] of `cdf` with context `ctx` at q[i]. */
+int quantile_many_ctx(cdf32_ctx_t cdf, const void * ctx, const float * q, double * x,
+    size_t n);
+
+/* Compute the exact quantiles x[i] of `sf` with context `ctx` at q[i]. */
+int quantile_many_sf_ctx(cdf32_ctx_t sf, const void * ctx, const float * q, double * x,
+    size_t n);
+
+/* Compute the exact quantiles x[i] of `ddf` with context `ctx` at (d[i], q[i]). */
+int quantile_many_ext_ctx(ddf32_ctx_t ddf, const void * ctx, const bool * d,
+    const float * q, double * x, size_t n);
+
 /* Compute the exact lower `xlo` and upper `xhi` bound of `cdf`. */
 void bounds_quantile(cdf32_t cdf, double * xlo, double * xhi);
 
@@ -57,12 +180,242 @@ void bounds_quantile_sf(cdf32_t sf, double * xlo, double * xhi);
 /* Compute the exact lower `xlo` and upper `xhi` bound of `ddf`. */
 void bounds_quantile_ext(ddf32_t ddf, double * xlo, double * xhi);
 
+/* Compute the exact lower `xlo` and upper `xhi` bound of `cdf` with context `ctx`. */
+void bounds_quantile_ctx(cdf32_ctx_t cdf, const void * ctx, double * xlo, double * xhi);
+
+/* Compute the exact lower `xlo` and upper `xhi` bound of `sf` with context `ctx`. */
+void bounds_quantile_sf_ctx(cdf32_ctx_t sf, const void * ctx, double * xlo, double * xhi);
+
+/* Compute the exact lower `xlo` and upper `xhi` bound of `ddf` with context `ctx`. */
+void bounds_quantile_ext_ctx(ddf32_ctx_t ddf, const void * ctx, double * xlo, double * xhi);
+
+// Longest common prefix `b`, with `l` active bits, of the lex indexes of
+// the lower and upper bounds of a distribution.
+struct support_prefix {
+    uint64_t b;
+    unsigned int l;
+};
+
+/** Compute the lex-tree node that contains the support of `cdf`. */
+struct support_prefix make_support_prefix(cdf32_t cdf);
+
+/** Compute the lex-tree node that contains the support of `ddf`. */
+struct support_prefix make_support_prefix_ext(ddf32_t ddf);
+
+/** Generate random variables optimally from `cdf`, starting at `prefix`. */
+double generate_opt_prefix(cdf32_t cdf, const struct support_prefix * prefix,
+    struct flip_state * prng);
+
+/** Generate random variables optimally from `ddf`, starting at `prefix`. */
+double generate_opt_prefix_ext(ddf32_t ddf, const struct support_prefix * prefix,
+    struct flip_state * prng);
+
+/** Compute the lex-tree node that contains the support of `cdf` with context `ctx`. */
+struct support_prefix make_support_prefix_ctx(cdf32_ctx_t cdf, const void * ctx);
+
+/** Compute the lex-tree node that contains the support of `ddf` with context `ctx`. */
+struct support_prefix make_support_prefix_ext_ctx(ddf32_ctx_t ddf, const void * ctx);
+
+/** Generate random variables optimally from `cdf` with context `ctx`,
+    starting at `prefix`. */
+double generate_opt_prefix_ctx(cdf32_ctx_t cdf, const void * ctx,
+    const struct support_prefix * prefix, struct flip_state * prng);
+
+/** Generate random variables optimally from `ddf` with context `ctx`,
+    starting at `prefix`. */
+double generate_opt_prefix_ext_ctx(ddf32_ctx_t ddf, const void * ctx,
+    const struct support_prefix * prefix, struct flip_state * prng);
+
+/** Generate random variables from `cdf` conditioned on a < X <= b, using
+    one CBS coin per split (about 44 flips per draw, against about 25 for
+    `generate_opt`). The endpoints are ordered with -0.0 < +0.0. Returns NaN
+    if a >= b, either is NaN, or cdf(a) == cdf(b). */
+double generate_opt_truncated(cdf32_t cdf, double a, double b, struct flip_state * prng);
+
+/** Generate random variables from `ddf` conditioned on a < X <= b.
+    Returns NaN if a >= b, either is NaN, or ddf(a) == ddf(b). */
+double generate_opt_truncated_ext(ddf32_t ddf, double a, double b, struct flip_state * prng);
+
+/** Generate random variables from `cdf` with context `ctx` conditioned on
+    a < X <= b. */
+double generate_opt_truncated_ctx(cdf32_ctx_t cdf, const void * ctx, double a, double b,
+    struct flip_state * prng);
+
+/** Generate random variables from `ddf` with context `ctx` conditioned on
+    a < X <= b. */
+double generate_opt_truncated_ext_ctx(ddf32_ctx_t ddf, const void * ctx, double a, double b,
+    struct flip_state * prng);
+
+/** Generate random variables optimally from `cdf`, whose atoms are
+    candidates of `atom`, ending the descent at a node with a single atom. */
+double generate_opt_atom(cdf32_t cdf, atom_t atom, struct flip_state * prng);
+
+/** Generate random variables optimally from `ddf`, whose atoms are
+    candidates of `atom`, ending the descent at a node with a single atom. */
+double generate_opt_atom_ext(ddf32_t ddf, atom_t atom, struct flip_state * prng);
+
+/** Generate random variables optimally from `cdf` with context `ctx`, whose
+    atoms are candidates of `atom`. */
+double generate_opt_atom_ctx(cdf32_ctx_t cdf, const void * ctx, atom_t atom,
+    struct flip_state * prng);
+
+/** Generate random variables optimally from `ddf` with context `ctx`, whose
+    atoms are candidates of `atom`. */
+double generate_opt_atom_ext_ctx(ddf32_ctx_t ddf, const void * ctx, atom_t atom,
+    struct flip_state * prng);
+
+/** Atom hook for the distributions over unsigned integers, i.e., those made
+    by MAKE_CDF_UINT_P, whose candidates are +0.0, 1, 2, .... */
+double atom_uint(double x);
+
+/** Generate random floats optimally from `cdf`, over the lex tree of floats. */
+float generate_optf(cdf32_t cdf, struct flip_state * prng);
+
+/** Generate random floats optimally from `ddf`, over the lex tree of floats. */
+float generate_optf_ext(ddf32_t ddf, struct flip_state * prng);
+
+/** Generate random floats optimally from `cdf` with context `ctx`. */
+float generate_optf_ctx(cdf32_ctx_t cdf, const void * ctx, struct flip_state * prng);
+
+/** Generate random floats optimally from `ddf` with context `ctx`. */
+float generate_optf_ext_ctx(ddf32_ctx_t ddf, const void * ctx, struct flip_state * prng);
+
+/* Compute the exact `q`-quantile of the `cdf` over the floats. */
+float quantilef(cdf32_t cdf, float q);
+
+/* Compute the exact `q`-quantile of the `sf` over the floats. */
+float quantilef_sf(cdf32_t sf, float q);
+
+/* Compute the exact `q`-quantile of the `ddf` over the floats. */
+float quantilef_ext(ddf32_t ddf, bool d, float q);
+
+/* Compute the exact `q`-quantile of the `cdf` with context `ctx` over the floats. */
+float quantilef_ctx(cdf32_ctx_t cdf, const void * ctx, float q);
+
+/* Compute the exact `q`-quantile of the `sf` with context `ctx` over the floats. */
+float quantilef_sf_ctx(cdf32_ctx_t sf, const void * ctx, float q);
+
+/* Compute the exact `q`-quantile of the `ddf` with context `ctx` over the floats. */
+float quantilef_ext_ctx(ddf32_ctx_t ddf, const void * ctx, bool d, float q);
+
+/** Generate random unsigned integers optimally from `cdf`, over a tree of
+    the integers whose depth at k is at most 7 + log2(k+1). */
+uint64_t generate_opt_uint(cdf_uint_t cdf, struct flip_state * prng);
+
+/** Generate random unsigned integers optimally from `cdf` with context `ctx`. */
+uint64_t generate_opt_uint_ctx(cdf_uint_ctx_t cdf, const void * ctx, struct flip_state * prng);
+
+// As `generate_opt_split`, for children whose masses are differences of doubles.
+unsigned char generate_opt_split64(const struct subtract_exact64_s * ss0,
+    const struct subtract_exact64_s * ss1, unsigned int * ell, struct flip_state * prng);
+
+/** Generate random variables optimally from the double-precision `cdf`. */
+double generate_opt64(cdf64_t cdf, struct flip_state * prng);
+
+/** Generate random variables optimally from the double-precision `ddf`. */
+double generate_opt64_ext(ddf64_t ddf, struct flip_state * prng);
+
+/** Generate random variables optimally from the double-precision `cdf` with
+    context `ctx`. */
+double generate_opt64_ctx(cdf64_ctx_t cdf, const void * ctx, struct flip_state * prng);
+
+/** Generate random variables optimally from the double-precision `ddf` with
+    context `ctx`. */
+double generate_opt64_ext_ctx(ddf64_ctx_t ddf, const void * ctx, struct flip_state * prng);
+
+/* Compute the exact `q`-quantile of the double-precision `cdf`. */
+double quantile64(cdf64_t cdf, double q);
+
+/* Compute the exact `q`-quantile of the double-precision `sf`. */
+double quantile64_sf(cdf64_t sf, double q);
+
+/* Compute the exact `q`-quantile of the double-precision `ddf`. */
+double quantile64_ext(ddf64_t ddf, bool d, double q);
+
+/* Compute the exact `q`-quantile of the double-precision `cdf` with context `ctx`. */
+double quantile64_ctx(cdf64_ctx_t cdf, const void * ctx, double q);
+
+/* Compute the exact `q`-quantile of the double-precision `sf` with context `ctx`. */
+double quantile64_sf_ctx(cdf64_ctx_t sf, const void * ctx, double q);
+
+/* Compute the exact `q`-quantile of the double-precision `ddf` with context `ctx`. */
+double quantile64_ext_ctx(ddf64_ctx_t ddf, const void * ctx, bool d, double q);
+
+/* Compute the exact lower `xlo` and upper `xhi` bound of the double-precision `cdf`. */
+void bounds_quantile64(cdf64_t cdf, double * xlo, double * xhi);
+
+/* Compute the exact lower `xlo` and upper `xhi` bound of the double-precision `sf`. */
+void bounds_quantile64_sf(cdf64_t sf, double * xlo, double * xhi);
+
+/* Compute the exact lower `xlo` and upper `xhi` bound of the double-precision `ddf`. */
+void bounds_quantile64_ext(ddf64_t ddf, double * xlo, double * xhi);
+
+/* Compute the exact lower `xlo` and upper `xhi` bound of the double-precision
+   `cdf` with context `ctx`. */
+void bounds_quantile64_ctx(cdf64_ctx_t cdf, const void * ctx, double * xlo, double * xhi);
+
+/* Compute the exact lower `xlo` and upper `xhi` bound of the double-precision
+   `sf` with context `ctx`. */
+void bounds_quantile64_sf_ctx(cdf64_ctx_t sf, const void * ctx, double * xlo, double * xhi);
+
+/* Compute the exact lower `xlo` and upper `xhi` bound of the double-precision
+   `ddf` with context `ctx`. */
+void bounds_quantile64_ext_ctx(ddf64_ctx_t ddf, const void * ctx, double * xlo, double * xhi);
+
 /** Generate random variables from `cdf` using Conditional Bit Sampling. */
 double generate_cbs(cdf32_t cdf, struct flip_state * prng);
 
 /** Generate random variables from `ddf` using Conditional Bit Sampling. */
 double generate_cbs_ext(ddf32_t ddf, struct flip_state * prng);
 
+/** Generate random variables from `cdf` with context `ctx` using Conditional
+    Bit Sampling. */
+double generate_cbs_ctx(cdf32_ctx_t cdf, const void * ctx, struct flip_state * prng);
+
+/** Generate random variables from `ddf` with context `ctx` using Conditional
+    Bit Sampling. */
+double generate_cbs_ext_ctx(ddf32_ctx_t ddf, const void * ctx, struct flip_state * prng);
+
+// Errors reported by `rvg_ddf_make`, which may be combined.
+#define RVG_DDF_INVALID_CDF 1
+#define RVG_DDF_INVALID_SF  2
+
+/** A dual distribution function made at runtime from a CDF and SF with a
+    common context, as MAKE_DDF. It is evaluated by `rvg_ddf_eval`. */
+struct rvg_ddf {
+    cdf32_ctx_t cdf;        // Target CDF.
+    cdf32_ctx_t sf;         // Target SF.
+    const void * ctx;       // Context of cdf and sf.
+    double cutoff;          // Least x with CDF(x) > 1/2, above which sf is used.
+    bool sign;              // Sign bit of cutoff.
+};
+
+/** Make the dual distribution function `ddf` of `cdf` and `sf` with context
+    `ctx`, computing its cutoff once. Returns 0, or a combination of
+    RVG_DDF_INVALID_CDF and RVG_DDF_INVALID_SF if they are invalid. */
+int rvg_ddf_make(struct rvg_ddf * ddf, cdf32_ctx_t cdf, cdf32_ctx_t sf, const void * ctx);
+
+/** Evaluate the `struct rvg_ddf` passed as `ddf`, which is a ddf32_ctx_t,
+    e.g., generate_opt_ext_ctx(rvg_ddf_eval, &ddf, prng). */
+void rvg_ddf_eval(double x, const void * ddf, bool * d, float * q);
+
+/** As `struct rvg_ddf`, in double precision, as MAKE_DDF64. */
+struct rvg_ddf64 {
+    cdf64_ctx_t cdf;        // Target CDF.
+    cdf64_ctx_t sf;         // Target SF.
+    const void * ctx;       // Context of cdf and sf.
+    double cutoff;          // Least x with CDF(x) > 1/2, above which sf is used.
+    bool sign;              // Sign bit of cutoff.
+};
+
+/** Make the double-precision dual distribution function `ddf` of `cdf` and
+    `sf` with context `ctx`, with the same errors as `rvg_ddf_make`. */
+int rvg_ddf64_make(struct rvg_ddf64 * ddf, cdf64_ctx_t cdf, cdf64_ctx_t sf, const void * ctx);
+
+/** Evaluate the `struct rvg_ddf64` passed as `ddf`, which is a ddf64_ctx_t,
+    e.g., generate_opt64_ext_ctx(rvg_ddf64_eval, &ddf, prng). */
+void rvg_ddf64_eval(double x, const void * ddf, bool * d, double * q);
+
 // Macros for creating a compatible CDF, SF, and DDF.
 
 /* Distribution over doules. */
@@ -91,34 +444,79 @@ double generate_cbs_ext(ddf32_t ddf, struct flip_state * prng);
 /** Make a survival distribution over unsigned integers from the GSL. */
 #define MAKE_CDF_UINT_Q(name, func, ...) MAKE_CDF_UINT_GENERAL(name, func, 0., ##__VA_ARGS__)
 
-/** Make a dual distribution function. */
-#define MAKE_DDF(name, func_cdf, func_sf)                                \
-    const double name##__cutoff = quantile(func_cdf, nextafterf(.5, 1)); \
-    const bool name##__sign = signbit(name##__cutoff);        \
-    bool name##__abort = false;                               \
-    if(0.5 < func_cdf(nextafter(name##__cutoff, -INFINITY))) {     \
-        fprintf(stderr, "Invalid CDF detected.\n");          \
-        name##__abort = true;                                \
-    }                                                        \
-    if(0.5 <= func_sf(name##__cutoff)) {                     \
-        fprintf(stderr, "Invalid SF detected.\n");           \
-        name##__abort = true;                                \
-    }                                                        \
-    if (name##__abort) {                                     \
-        exit(1);                                             \
-    }                                                        \
-    void name(double x, bool * d, float * q) {               \
-        if ((x < name##__cutoff)                             \
-                || ((x == name##__cutoff)                    \
-                    && signbit(x)                            \
-                    && !(name##__sign))) {                   \
-            *d = 0;                                          \
-            *q = func_cdf(x);                                \
-        } else {                                             \
-            *d = 1;                                          \
-            *q = func_sf(x);                                 \
-        }                                                    \
-        assert(check_ddf_val(*d, *q));                       \
-     }
+/** Make a cumulative distribution over unsigned integers from the GSL, for
+    `generate_opt_uint`. Its value at k is that of MAKE_CDF_UINT_P at (double) k. */
+#define MAKE_CDF_UINT64_P(name, func, ...)  \
+  float name(uint64_t k__) {                \
+    return func((double) k__, ##__VA_ARGS__); \
+  }
+
+/* Distribution over doubles, in double precision. */
+#define MAKE_CDF64_GENERAL(name, func, nanx, ...) \
+  double name(double x__) {                       \
+    if (x__ != x__) { return nanx; }              \
+    return func(x__, ##__VA_ARGS__);              \
+  }
+
+/** Make a double-precision cumulative distribution over doubles from the GSL. */
+#define MAKE_CDF64_P(name, func, ...) MAKE_CDF64_GENERAL(name, func, 1., ##__VA_ARGS__)
+/** Make a double-precision survival distribution over doubles from the GSL. */
+#define MAKE_CDF64_Q(name, func, ...) MAKE_CDF64_GENERAL(name, func, 0., ##__VA_ARGS__)
+
+/** Make a dual distribution function. The cutoff of `func_cdf` and
+    `func_sf` is computed by `rvg_ddf_make` when the program starts, which
+    exits if either is invalid. Use it at file scope. */
+#define MAKE_DDF(name, func_cdf, func_sf)                                   \
+    static float name##__cdf(double x, const void * ctx) {                 \
+        (void) ctx;                                                         \
+        return func_cdf(x);                                                 \
+    }                                                                       \
+    static float name##__sf(double x, const void * ctx) {                  \
+        (void) ctx;                                                         \
+        return func_sf(x);                                                  \
+    }                                                                       \
+    static struct rvg_ddf name##__ddf;                                      \
+    __attribute__((constructor)) static void name##__make(void) {          \
+        int err = rvg_ddf_make(&name##__ddf, name##__cdf, name##__sf, NULL); \
+        if (err & RVG_DDF_INVALID_CDF) {                                    \
+            fprintf(stderr, "Invalid CDF detected.\n");                     \
+        }                                                                   \
+        if (err & RVG_DDF_INVALID_SF) {                                     \
+            fprintf(stderr, "Invalid SF detected.\n");                      \
+        }                                                                   \
+        if (err) {                                                          \
+            exit(1);                                                        \
+        }                                                                   \
+    }                                                                       \
+    void name(double x, bool * d, float * q) {                              \
+        rvg_ddf_eval(x, &name##__ddf, d, q);                                \
+    }
+
+/** Make a double-precision dual distribution function, as MAKE_DDF. */
+#define MAKE_DDF64(name, func_cdf, func_sf)                                 \
+    static double name##__cdf(double x, const void * ctx) {                \
+        (void) ctx;                                                         \
+        return func_cdf(x);                                                 \
+    }                                                                       \
+    static double name##__sf(double x, const void * ctx) {                 \
+        (void) ctx;                                                         \
+        return func_sf(x);                                                  \
+    }                                                                       \
+    static struct rvg_ddf64 name##__ddf;                                    \
+    __attribute__((constructor)) static void name##__make(void) {          \
+        int err = rvg_ddf64_make(&name##__ddf, name##__cdf, name##__sf, NULL); \
+        if (err & RVG_DDF_INVALID_CDF) {                                    \
+            fprintf(stderr, "Invalid CDF detected.\n");                     \
+        }                                                                   \
+        if (err & RVG_DDF_INVALID_SF) {                                     \
+            fprintf(stderr, "Invalid SF detected.\n");                      \
+        }                                                                   \
+        if (err) {                                                          \
+            exit(1);                                                        \
+        }                                                                   \
+    }                                                                       \
+    void name(double x, bool * d, double * q) {                             \
+        rvg_ddf64_eval(x, &name##__ddf, d, q);                              \
+    }
 
 #endif
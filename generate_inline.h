@@ -0,0 +1,422 @@
+/*
+  Name:     generate_inline.h
+  Purpose:  Generate a random variate from a target known at compile time.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#ifndef GENERATE_INLINE_H
+#define GENERATE_INLINE_H
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <gmp.h>
+
+#include "arithmetic.h"
+#include "bits.h"
+#include "flip.h"
+#include "generate.h"
+#include "stats.h"
+
+// The generators in generate.c take the target as a function pointer, which
+// the compiler cannot inline into the traversal of the lex tree. Their
+// bodies are defined below, taking a target with a context, and are forced
+// inline into each caller, together with the arithmetic of arithmetic.h and
+// bits.h. The functions of generate.c instantiate them with the target of
+// the caller, and the functions and macros at the end of this file with a
+// constant target, so that a target whose definition is visible becomes a
+// direct call, which the compiler may inline and combine with the
+// traversal. A plain cdf32_t or ddf32_t is passed as the context of an
+// adapter, which is inlined in turn.
+
+#define RVG_INLINE static inline __attribute__((always_inline))
+
+RVG_INLINE float cdf_plain(double x, const void * ctx) {
+    return (*(const cdf32_t *) ctx)(x);
+}
+
+RVG_INLINE void ddf_plain(double x, const void * ctx, bool * d, float * q) {
+    (*(const ddf32_t *) ctx)(x, d, q);
+}
+
+// Choose the child of the node with `l` active bits whose left endpoint,
+// midpoint, and right endpoint have CDF values cdf_l <= cdf_m <= cdf_r,
+// where `ell` is the depth reached so far in the entropy-optimal tree. A
+// trivial node consumes no bits and leaves `ell` unchanged.
+RVG_INLINE unsigned char generate_opt_child(
+        float cdf_l
+        , float cdf_m
+        , float cdf_r
+        , unsigned int l
+        , unsigned int * ell
+        , struct flip_state * prng
+        ) {
+    assert(cdf_l <= cdf_m);
+    assert(cdf_m <= cdf_r);
+
+    // Trivial case.
+    if (cdf_m == cdf_r) {
+        RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, *ell);
+        return 0;
+    }
+    if (cdf_m == cdf_l) {
+        RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, *ell);
+        return 1;
+    }
+
+    // Finite arithmetic case.
+    struct subtract_exact_s ss0, ss1;
+    subtract_exact(SUB_0, cdf_m, cdf_l, &ss0);
+    subtract_exact(SUB_0, cdf_r, cdf_m, &ss1);
+
+    #ifndef NDEBUG
+    mpq_t kn0; mpq_init(kn0);
+    mpq_t kn1; mpq_init(kn1);
+    mpz_t k0; mpz_init(k0);
+    mpz_t n0; mpz_init(n0);
+    mpz_t k1; mpz_init(k1);
+    mpz_t n1; mpz_init(n1);
+    subtract_gmp(SUB_0, kn0, cdf_m, cdf_l);
+    subtract_gmp(SUB_0, kn1, cdf_r, cdf_m);
+    mpq_get_num(k0, kn0); mpq_get_den(n0, kn0);
+    mpq_get_num(k1, kn1); mpq_get_den(n1, kn1);
+    unsigned int ell_0 = *ell;
+    #endif
+
+    unsigned char z = generate_opt_split(&ss0, &ss1, ell, prng);
+    RVG_STATS_LEVEL(RVG_TRACE_SPLIT, l, *ell);
+
+    #ifndef NDEBUG
+    for (unsigned int i = (ell_0 > 0) ? ell_0 : 1; i <= *ell; i++) {
+        assert(ith_bit_of_exact(&ss0, i) == ith_bit_of_fraction_gmp(k0, n0, i));
+        assert(ith_bit_of_exact(&ss1, i) == ith_bit_of_fraction_gmp(k1, n1, i));
+    }
+    mpq_clear(kn0); mpq_clear(kn1);
+    mpz_clear(k0); mpz_clear(n0);
+    mpz_clear(k1); mpz_clear(n1);
+    #endif
+
+    return z;
+}
+
+// As `generate_opt_child`, for the DDF values (d_l, cdf_l), (d_m, cdf_m),
+// and (d_r, cdf_r).
+RVG_INLINE unsigned char generate_opt_child_ext(
+        bool d_l, float cdf_l
+        , bool d_m, float cdf_m
+        , bool d_r, float cdf_r
+        , unsigned int l
+        , unsigned int * ell
+        , struct flip_state * prng
+        ) {
+    assert(compare_lte_ext(d_l, cdf_l, d_m, cdf_m));
+    assert(compare_lte_ext(d_m, cdf_m, d_r, cdf_r));
+
+    // Trivial case.
+    if ((d_m == d_r) && (cdf_m == cdf_r)) {
+        RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, *ell);
+        return 0;
+    }
+    if ((d_m == d_l) && (cdf_m == cdf_l)) {
+        RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, *ell);
+        return 1;
+    }
+
+    // Finite arithmetic case.
+    struct subtract_exact_s ss0, ss1;
+    subtract_exact_ext(d_m, cdf_m, d_l, cdf_l, &ss0);
+    subtract_exact_ext(d_r, cdf_r, d_m, cdf_m, &ss1);
+
+    #ifndef NDEBUG
+    mpq_t kn0; mpq_init(kn0);
+    mpq_t kn1; mpq_init(kn1);
+    mpz_t k0; mpz_init(k0);
+    mpz_t n0; mpz_init(n0);
+    mpz_t k1; mpz_init(k1);
+    mpz_t n1; mpz_init(n1);
+    subtract_gmp_ext(kn0, d_m, cdf_m, d_l, cdf_l);
+    subtract_gmp_ext(kn1, d_r, cdf_r, d_m, cdf_m);
+    mpq_get_num(k0, kn0); mpq_get_den(n0, kn0);
+    mpq_get_num(k1, kn1); mpq_get_den(n1, kn1);
+    unsigned int ell_0 = *ell;
+    #endif
+
+    unsigned char z = generate_opt_split(&ss0, &ss1, ell, prng);
+    RVG_STATS_LEVEL(RVG_TRACE_SPLIT, l, *ell);
+
+    #ifndef NDEBUG
+    for (unsigned int i = (ell_0 > 0) ? ell_0 : 1; i <= *ell; i++) {
+        assert(ith_bit_of_exact(&ss0, i) == ith_bit_of_fraction_gmp(k0, n0, i));
+        assert(ith_bit_of_exact(&ss1, i) == ith_bit_of_fraction_gmp(k1, n1, i));
+    }
+    mpq_clear(kn0); mpq_clear(kn1);
+    mpz_clear(k0); mpz_clear(n0);
+    mpz_clear(k1); mpz_clear(n1);
+    #endif
+
+    return z;
+}
+
+// Once the node b holds a single atom x of the target, every level below it
+// is a trivial case (the CDF is cdf_l before x and cdf_r from x onward), so
+// the descent can end at x without consuming any bits. This case is
+// detected using a hook that returns the next candidate atom, which is much
+// cheaper than the CDF. Since cdf_l < cdf_r holds at every node, a node
+// with exactly one candidate holds that atom.
+
+// If the node b of length l holds exactly one candidate of `atom`, store
+// it in `x` and return true.
+RVG_INLINE bool node_single_atom(atom_t atom, uint64_t b, unsigned int l, double * x) {
+    if (l == 0) { return false; }
+    unsigned int m = DBL_SIZE - l;                      // m = n - len(b)
+    uint64_t lex_lo = b << m;                           // b+'0'*m
+    uint64_t lex_hi = lex_lo + ((1ull << m) - 1);       // b+'1'*m
+    double t = atom(int2double(bij64_lex2float(lex_lo)));
+    if (isnan(t)) { return false; }
+    uint64_t lex_t = bij64_float2lex(double2int(t));
+    assert(lex_lo <= lex_t);
+    if (lex_hi < lex_t) { return false; }
+    if (lex_t < lex_hi) {
+        double u = atom(int2double(bij64_lex2float(lex_t + 1)));
+        if (!isnan(u) && (bij64_float2lex(double2int(u)) <= lex_hi)) {
+            return false;
+        }
+    }
+    *x = t;
+    return true;
+}
+
+// Body of `generate_opt`, `generate_opt_node`, `generate_opt_atom`, and
+// their variants, where `atom` is NULL if there is no atom hook.
+RVG_INLINE double generate_opt_node_common(
+        cdf32_ctx_t cdf         // Target CDF.
+        , const void * ctx      // Context of cdf.
+        , atom_t atom           // Atom hook of cdf, or NULL.
+        , uint64_t b            // Current bit string (lex order).
+        , unsigned int l        // Number of active bits in b, 0 <= l <= 64.
+        , unsigned int ell      // Current depth of the entropy-optimal tree.
+        , float cdf_l           // CDF(b0^m)
+        , float cdf_r           // CDF(b1^m)
+        , struct flip_state * prng
+        ) {
+
+    RVG_STATS_BEGIN(prng);
+
+    for (; l < DBL_SIZE; l++) {
+
+        // Finish the descent at a single atom.
+        double x;
+        if ((atom != NULL) && node_single_atom(atom, b, l, &x)) {
+            #ifndef NDEBUG
+            uint64_t lex_x = bij64_float2lex(double2int(x));
+            assert(cdf(x, ctx) == cdf_r);
+            assert((lex_x == 0) || (cdf(int2double(bij64_lex2float(lex_x - 1)), ctx) == cdf_l));
+            #endif
+            RVG_STATS_SAMPLE(prng, l, ell);
+            return x;
+        }
+
+        // Compute CDF at midpoint.
+        unsigned int m = DBL_SIZE - (l + 1);             // m = n_max - (len(b)+1)
+        uint64_t b_lex = (b << (m + 1)) + (1ull << m) - 1; // b+'0' + '1'*m
+        uint64_t b_flt = bij64_lex2float(b_lex);
+        double d = int2double(b_flt);
+        float cdf_m = cdf(d, ctx);
+        RVG_STATS_ADD(cdf_calls, 1);
+
+        // Move to b+'0' or b+'1'.
+        if (generate_opt_child(cdf_l, cdf_m, cdf_r, l, &ell, prng) == 0) {
+            b = b << 1;
+            cdf_r = cdf_m;
+        } else {
+            b = (b << 1) | 1;
+            cdf_l = cdf_m;
+        }
+    }
+
+    RVG_STATS_SAMPLE(prng, DBL_SIZE, ell);
+    b = bij64_lex2float(b);
+    return int2double(b);
+}
+
+// Body of `generate_opt_ext`, `generate_opt_node_ext`, `generate_opt_atom_ext`,
+// and their variants, where `atom` is NULL if there is no atom hook.
+RVG_INLINE double generate_opt_node_ext_common(
+        ddf32_ctx_t ddf         // Target dual distribution function (DDF).
+        , const void * ctx      // Context of ddf.
+        , atom_t atom           // Atom hook of ddf, or NULL.
+        , uint64_t b            // Current bit string (lex order).
+        , unsigned int l        // Number of active bits in b, 0 <= l <= 64.
+        , unsigned int ell      // Current depth of the entropy-optimal tree.
+        , bool d_l              // DDF(b0^m)
+        , float cdf_l           // DDF(b0^m)
+        , bool d_r              // DDF(b1^m)
+        , float cdf_r           // DDF(b1^m)
+        , struct flip_state * prng
+        ) {
+
+    RVG_STATS_BEGIN(prng);
+
+    for (; l < DBL_SIZE; l++) {
+
+        // Finish the descent at a single atom.
+        double x;
+        if ((atom != NULL) && node_single_atom(atom, b, l, &x)) {
+            #ifndef NDEBUG
+            uint64_t lex_x = bij64_float2lex(double2int(x));
+            bool d_x; float cdf_x;
+            ddf(x, ctx, &d_x, &cdf_x);
+            assert((d_x == d_r) && (cdf_x == cdf_r));
+            if (0 < lex_x) {
+                ddf(int2double(bij64_lex2float(lex_x - 1)), ctx, &d_x, &cdf_x);
+                assert((d_x == d_l) && (cdf_x == cdf_l));
+            }
+            #endif
+            RVG_STATS_SAMPLE(prng, l, ell);
+            return x;
+        }
+
+        // Compute DDF at midpoint.
+        unsigned int m = DBL_SIZE - (l + 1);             // m = n_max - (len(b)+1)
+        uint64_t b_lex = (b << (m + 1)) + (1ull << m) - 1; // b+'0' + '1'*m
+        uint64_t b_flt = bij64_lex2float(b_lex);
+        double d = int2double(b_flt);
+        bool d_m; float cdf_m;
+        ddf(d, ctx, &d_m, &cdf_m);
+        RVG_STATS_ADD(cdf_calls, 1);
+
+        // Move to b+'0' or b+'1'.
+        if (generate_opt_child_ext(d_l, cdf_l, d_m, cdf_m, d_r, cdf_r, l, &ell, prng) == 0) {
+            b = b << 1;
+            d_r = d_m; cdf_r = cdf_m;
+        } else {
+            b = (b << 1) | 1;
+            d_l = d_m; cdf_l = cdf_m;
+        }
+    }
+
+    RVG_STATS_SAMPLE(prng, DBL_SIZE, ell);
+    b = bij64_lex2float(b);
+    return int2double(b);
+}
+
+// Body of `quantile` and its variants.
+RVG_INLINE double quantile_common(cdf32_ctx_t cdf, const void * ctx, float q) {
+    assert((0 <= q) && (q <= 1));
+    uint64_t lo = 0;
+    uint64_t hi = 0xffffffffffffffff;
+    union double_bits mid;
+    double x = NAN;
+    int iter = 0;
+    while (1) {
+        iter++;
+        uint64_t m = lo/2 + hi/2;
+        mid.i = bij64_lex2float(m);
+        float cdf_mid = cdf(mid.f, ctx);
+        if (q <= cdf_mid) {
+            x = mid.f;
+            if (hi == lo) { break; }
+            hi = m - 1;
+        } else {
+            if (lo == hi) { break; }
+            lo = m + 1;
+        }
+    }
+    assert(iter == 64);
+    return x;
+}
+
+// Body of `quantile_sf` and its variants.
+RVG_INLINE double quantile_sf_common(cdf32_ctx_t sf, const void * ctx, float q) {
+    assert((0 < q) && (q <= 1));
+    uint64_t lo = 0;
+    uint64_t hi = 0xffffffffffffffff;
+    union double_bits mid;
+    double x = NAN;
+    int iter = 0;
+    while (1) {
+        iter++;
+        uint64_t m = lo/2 + hi/2;
+        mid.i = bij64_lex2float(m);
+        float sf_mid = sf(mid.f, ctx);
+        if (sf_mid < q) {
+            x = mid.f;
+            if (hi == lo) { break; }
+            hi = m - 1;
+        } else {
+            if (lo == hi) { break; }
+            lo = m + 1;
+        }
+    }
+    assert(iter == 64);
+    return x;
+}
+
+// Body of `quantile_ext` and its variants.
+RVG_INLINE double quantile_ext_common(ddf32_ctx_t ddf, const void * ctx, bool d, float q) {
+    assert(check_ddf_val(d, q));
+    uint64_t lo = 0;
+    uint64_t hi = 0xffffffffffffffff;
+    union double_bits mid;
+    bool d_mid; float cdf_mid;
+    double x = NAN;
+    int iter = 0;
+    while (1) {
+        iter++;
+        uint64_t m = lo/2 + hi/2;
+        mid.i = bij64_lex2float(m);
+        ddf(mid.f, ctx, &d_mid, &cdf_mid);
+        if (compare_lte_ext(d, q, d_mid, cdf_mid)) {
+            x = mid.f;
+            if (hi == lo) { break; }
+            hi = m - 1;
+        } else {
+            if (lo == hi) { break; }
+            lo = m + 1;
+        }
+    }
+    assert(iter == 64);
+    return x;
+}
+
+/** As `generate_opt`, inlined into the caller. */
+RVG_INLINE double generate_opt_inline(cdf32_t cdf, struct flip_state * prng) {
+    return generate_opt_node_common(cdf_plain, &cdf, NULL, 0, 0, 0, 0, 1, prng);
+}
+
+/** As `generate_opt_ext`, inlined into the caller. */
+RVG_INLINE double generate_opt_ext_inline(ddf32_t ddf, struct flip_state * prng) {
+    return generate_opt_node_ext_common(ddf_plain, &ddf, NULL, 0, 0, 0, 0, 0, 1, 0, prng);
+}
+
+/** As `quantile`, inlined into the caller. */
+RVG_INLINE double quantile_inline(cdf32_t cdf, float q) {
+    return quantile_common(cdf_plain, &cdf, q);
+}
+
+// Macros for defining generators specialized to a target at file scope,
+// where `name` is a fresh C identifier. A target defined inside a function
+// (e.g., by MAKE_CDF_P) can be passed to the functions above directly.
+
+/** Define `double name(struct flip_state * prng)` as `generate_opt` on `cdf`. */
+#define MAKE_GENERATE_OPT(name, cdf)                            \
+  static inline double name(struct flip_state * prng__) {      \
+    return generate_opt_inline(cdf, prng__);                    \
+  }
+
+/** Define `double name(struct flip_state * prng)` as `generate_opt_ext` on `ddf`. */
+#define MAKE_GENERATE_OPT_EXT(name, ddf)                        \
+  static inline double name(struct flip_state * prng__) {      \
+    return generate_opt_ext_inline(ddf, prng__);                \
+  }
+
+/** Define `double name(float q)` as `quantile` on `cdf`. */
+#define MAKE_QUANTILE(name, cdf)                                \
+  static inline double name(float q__) {                        \
+    return quantile_inline(cdf, q__);                           \
+  }
+
+#endif
@@ -0,0 +1,283 @@
+/*
+  Name:     pool.c
+  Purpose:  Generate random variates on multiple threads with work stealing.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "generate_inline.h"
+#include "prng.h"
+#include "pool.h"
+
+// The indexes [0, n) of a job are split into chunks of RVG_POOL_GRAIN
+// indexes, which are split evenly among the workers. Each worker generates
+// one chunk at a time from the front of its own range, and once it is
+// empty, steals the back half of the range of another worker. The cost of
+// a single variate varies widely, since a traversal may end anywhere from
+// the trivial levels to a long inner loop, so stealing keeps every worker
+// busy until the job is done. Before each chunk, the worker positions its
+// generator at the start of the stream of the chunk, so that stealing only
+// moves work, and the variates do not depend on which worker draws them.
+
+// Seed of stream `i`, using the finalizer of SplitMix64.
+static unsigned long pool_seed(unsigned long seed, uint64_t i) {
+    uint64_t z = seed + (i + 1) * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Take the chunk `c` from the front of the range of `w`.
+static bool pool_take(struct rvg_pool_worker * w, size_t * c) {
+    pthread_mutex_lock(&w->lock);
+    bool taken = w->lo < w->hi;
+    if (taken) { *c = w->lo++; }
+    pthread_mutex_unlock(&w->lock);
+    return taken;
+}
+
+// Move the back half of the range of some other worker into that of `w`.
+static bool pool_steal(struct rvg_pool_worker * w) {
+    struct rvg_pool * pool = w->pool;
+    for (unsigned int j = 1; j < pool->num_workers; j++) {
+        struct rvg_pool_worker * v = &pool->workers[(w->id + j) % pool->num_workers];
+        pthread_mutex_lock(&v->lock);
+        size_t k = v->hi - v->lo;
+        if (k == 0) {
+            pthread_mutex_unlock(&v->lock);
+            continue;
+        }
+        size_t mid = v->hi - (k + 1) / 2;
+        size_t hi = v->hi;
+        v->hi = mid;
+        pthread_mutex_unlock(&v->lock);
+        pthread_mutex_lock(&w->lock);
+        w->lo = mid;
+        w->hi = hi;
+        pthread_mutex_unlock(&w->lock);
+        return true;
+    }
+    return false;
+}
+
+// Position the generator of `w` at the start of stream `i`.
+static void pool_set_stream(struct rvg_pool_worker * w, uint64_t i) {
+    struct rvg_pool * pool = w->pool;
+    if (pool->T == gsl_rng_philox) {
+        philox_set(w->rng, pool->seed, i, 0);
+    } else {
+        gsl_rng_set(w->rng, pool_seed(pool->seed, i));
+    }
+    flip_reset(&w->prng);
+}
+
+static void pool_run(struct rvg_pool_worker * w) {
+    struct rvg_pool * pool = w->pool;
+    size_t c;
+    while (pool_take(w, &c) || (pool_steal(w) && pool_take(w, &c))) {
+        pool_set_stream(w, pool->stream + c);
+        size_t lo = c * RVG_POOL_GRAIN;
+        size_t hi = min(lo + RVG_POOL_GRAIN, pool->n);
+        for (size_t i = lo; i < hi; i++) {
+            switch (pool->method) {
+                case RVG_POOL_OPT:
+                    pool->out[i] = generate_opt_ctx(pool->cdf, pool->ctx, &w->prng);
+                    break;
+                case RVG_POOL_OPT_EXT:
+                    pool->out[i] = generate_opt_ext_ctx(pool->ddf, pool->ctx, &w->prng);
+                    break;
+                case RVG_POOL_CBS:
+                    pool->out[i] = generate_cbs_ctx(pool->cdf, pool->ctx, &w->prng);
+                    break;
+                case RVG_POOL_CBS_EXT:
+                    pool->out[i] = generate_cbs_ext_ctx(pool->ddf, pool->ctx, &w->prng);
+                    break;
+            }
+        }
+    }
+}
+
+static void * pool_thread(void * arg) {
+    struct rvg_pool_worker * w = arg;
+    struct rvg_pool * pool = w->pool;
+    unsigned long epoch = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while ((pool->epoch == epoch) && !pool->shutdown) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->shutdown) { break; }
+        epoch = pool->epoch;
+        pthread_mutex_unlock(&pool->lock);
+        pool_run(w);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->num_active == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// Stop the threads of workers [1, num_threads), which are running, and free
+// the pool, whose workers [0, num_rngs) are initialized.
+static void pool_release(struct rvg_pool * pool, unsigned int num_rngs,
+        unsigned int num_threads) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (unsigned int i = 1; i < num_threads; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (unsigned int i = 0; i < num_rngs; i++) {
+        pthread_mutex_destroy(&pool->workers[i].lock);
+        gsl_rng_free(pool->workers[i].rng);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->workers);
+    free(pool);
+}
+
+struct rvg_pool * rvg_pool_alloc(unsigned int num_threads, const gsl_rng_type * T,
+        unsigned long seed) {
+    if (num_threads == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = (ncpu < 1) ? 1 : ncpu;
+    }
+    struct rvg_pool * pool = malloc(sizeof(struct rvg_pool));
+    if (pool == NULL) { return NULL; }
+    pool->workers = aligned_alloc(
+        __alignof__(struct rvg_pool_worker),
+        num_threads * sizeof(struct rvg_pool_worker));
+    if (pool->workers == NULL) {
+        free(pool);
+        return NULL;
+    }
+    pool->num_workers = num_threads;
+    pool->epoch = 0;
+    pool->num_active = 0;
+    pool->shutdown = false;
+    pool->T = T;
+    pool->seed = seed;
+    pool->stream = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (unsigned int i = 0; i < num_threads; i++) {
+        struct rvg_pool_worker * w = &pool->workers[i];
+        pthread_mutex_init(&w->lock, NULL);
+        w->lo = w->hi = 0;
+        w->pool = pool;
+        w->id = i;
+        w->rng = gsl_rng_alloc(T);
+        if (w->rng == NULL) {
+            pthread_mutex_destroy(&w->lock);
+            pool_release(pool, i, 0);
+            return NULL;
+        }
+        w->prng = make_flip_state(w->rng);
+    }
+    for (unsigned int i = 1; i < num_threads; i++) {
+        struct rvg_pool_worker * w = &pool->workers[i];
+        if (pthread_create(&w->thread, NULL, pool_thread, w) != 0) {
+            pool_release(pool, num_threads, i);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void rvg_pool_free(struct rvg_pool * pool) {
+    pool_release(pool, pool->num_workers, pool->num_workers);
+}
+
+static void rvg_pool_generate_common(
+        struct rvg_pool * pool
+        , enum rvg_pool_method method
+        , cdf32_ctx_t cdf
+        , ddf32_ctx_t ddf
+        , const void * ctx
+        , double * out
+        , size_t n
+        ) {
+    if (n == 0) { return; }
+
+    // Split the chunks of the job evenly among the workers.
+    size_t m = (n - 1) / RVG_POOL_GRAIN + 1;
+    for (unsigned int i = 0; i < pool->num_workers; i++) {
+        struct rvg_pool_worker * w = &pool->workers[i];
+        pthread_mutex_lock(&w->lock);
+        w->lo = m / pool->num_workers * i + min(i, m % pool->num_workers);
+        w->hi = w->lo + m / pool->num_workers + (i < m % pool->num_workers);
+        pthread_mutex_unlock(&w->lock);
+    }
+
+    // Start the threads, and run worker 0 on the calling thread.
+    pthread_mutex_lock(&pool->lock);
+    pool->method = method;
+    pool->cdf = cdf;
+    pool->ddf = ddf;
+    pool->ctx = ctx;
+    pool->out = out;
+    pool->n = n;
+    pool->num_active = pool->num_workers - 1;
+    pool->epoch++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    pool_run(&pool->workers[0]);
+
+    pthread_mutex_lock(&pool->lock);
+    while (0 < pool->num_active) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pool->stream += m;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// A plain target is the context of its adapter, which lives until the job
+// is done.
+void rvg_pool_generate(struct rvg_pool * pool, cdf32_t cdf, double * out, size_t n) {
+    rvg_pool_generate_common(pool, RVG_POOL_OPT, cdf_plain, NULL, &cdf, out, n);
+}
+
+void rvg_pool_generate_ext(struct rvg_pool * pool, ddf32_t ddf, double * out, size_t n) {
+    rvg_pool_generate_common(pool, RVG_POOL_OPT_EXT, NULL, ddf_plain, &ddf, out, n);
+}
+
+void rvg_pool_generate_cbs(struct rvg_pool * pool, cdf32_t cdf, double * out, size_t n) {
+    rvg_pool_generate_common(pool, RVG_POOL_CBS, cdf_plain, NULL, &cdf, out, n);
+}
+
+void rvg_pool_generate_cbs_ext(struct rvg_pool * pool, ddf32_t ddf, double * out, size_t n) {
+    rvg_pool_generate_common(pool, RVG_POOL_CBS_EXT, NULL, ddf_plain, &ddf, out, n);
+}
+
+void rvg_pool_generate_ctx(struct rvg_pool * pool, cdf32_ctx_t cdf, const void * ctx,
+        double * out, size_t n) {
+    rvg_pool_generate_common(pool, RVG_POOL_OPT, cdf, NULL, ctx, out, n);
+}
+
+void rvg_pool_generate_ext_ctx(struct rvg_pool * pool, ddf32_ctx_t ddf, const void * ctx,
+        double * out, size_t n) {
+    rvg_pool_generate_common(pool, RVG_POOL_OPT_EXT, NULL, ddf, ctx, out, n);
+}
+
+void rvg_pool_generate_cbs_ctx(struct rvg_pool * pool, cdf32_ctx_t cdf, const void * ctx,
+        double * out, size_t n) {
+    rvg_pool_generate_common(pool, RVG_POOL_CBS, cdf, NULL, ctx, out, n);
+}
+
+void rvg_pool_generate_cbs_ext_ctx(struct rvg_pool * pool, ddf32_ctx_t ddf, const void * ctx,
+        double * out, size_t n) {
+    rvg_pool_generate_common(pool, RVG_POOL_CBS_EXT, NULL, ddf, ctx, out, n);
+}
@@ -0,0 +1,110 @@
+/*
+  Name:     pool.h
+  Purpose:  Generate random variates on multiple threads with work stealing.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <gsl/gsl_rng.h>
+
+#include "flip.h"
+#include "generate.h"
+
+// Number of variates in a chunk, which a worker takes from its own range at
+// a time and draws from its own stream.
+#define RVG_POOL_GRAIN 16
+
+// Generation method of a job.
+enum rvg_pool_method {
+    RVG_POOL_OPT,
+    RVG_POOL_OPT_EXT,
+    RVG_POOL_CBS,
+    RVG_POOL_CBS_EXT,
+};
+
+// A worker owns a generator and the range [lo, hi) of chunks of the current
+// job that it has not yet generated, which other workers may steal from the
+// back.
+struct rvg_pool_worker {
+    pthread_mutex_t lock;
+    size_t lo;
+    size_t hi;
+    gsl_rng * rng;
+    struct flip_state prng;
+    pthread_t thread;
+    struct rvg_pool * pool;
+    unsigned int id;
+} __attribute__((aligned(64)));
+
+/** A pool of threads, each with its own `flip_state`. */
+struct rvg_pool {
+    unsigned int num_workers;           // Including the calling thread.
+    struct rvg_pool_worker * workers;   // Worker 0 is the calling thread.
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long epoch;                // Number of jobs started.
+    unsigned int num_active;            // Threads still running the job.
+    bool shutdown;
+    const gsl_rng_type * T;             // Type of the generators.
+    unsigned long seed;                 // Seed of the streams of the chunks.
+    uint64_t stream;                    // Stream of chunk 0 of the current job.
+    // Current job.
+    enum rvg_pool_method method;
+    cdf32_ctx_t cdf;
+    ddf32_ctx_t ddf;
+    const void * ctx;
+    double * out;
+    size_t n;
+};
+
+/** Allocate a pool of `num_threads` workers (0 for one per online CPU),
+    each with a generator of type `T`. The jobs of the pool are split into
+    chunks of RVG_POOL_GRAIN variates, numbered across the jobs, and chunk
+    c is drawn from stream c of `seed` if `T` is `gsl_rng_philox`, or from
+    a generator seeded from (`seed`, c) otherwise. The variates of a job
+    are thus a function of `seed` and of the sizes of the job and of the
+    earlier jobs, and not of the number of threads or their scheduling.
+    Returns NULL if a generator or thread cannot be created. */
+struct rvg_pool * rvg_pool_alloc(unsigned int num_threads, const gsl_rng_type * T,
+    unsigned long seed);
+
+/** Free a pool and join its threads. */
+void rvg_pool_free(struct rvg_pool * pool);
+
+/** Fill `out` with `n` variates from `generate_opt` on `cdf`. */
+void rvg_pool_generate(struct rvg_pool * pool, cdf32_t cdf, double * out, size_t n);
+
+/** Fill `out` with `n` variates from `generate_opt_ext` on `ddf`. */
+void rvg_pool_generate_ext(struct rvg_pool * pool, ddf32_t ddf, double * out, size_t n);
+
+/** Fill `out` with `n` variates from `generate_cbs` on `cdf`. */
+void rvg_pool_generate_cbs(struct rvg_pool * pool, cdf32_t cdf, double * out, size_t n);
+
+/** Fill `out` with `n` variates from `generate_cbs_ext` on `ddf`. */
+void rvg_pool_generate_cbs_ext(struct rvg_pool * pool, ddf32_t ddf, double * out, size_t n);
+
+/** Fill `out` with `n` variates from `generate_opt_ctx` on `cdf` with context `ctx`. */
+void rvg_pool_generate_ctx(struct rvg_pool * pool, cdf32_ctx_t cdf, const void * ctx,
+    double * out, size_t n);
+
+/** Fill `out` with `n` variates from `generate_opt_ext_ctx` on `ddf` with context `ctx`. */
+void rvg_pool_generate_ext_ctx(struct rvg_pool * pool, ddf32_ctx_t ddf, const void * ctx,
+    double * out, size_t n);
+
+/** Fill `out` with `n` variates from `generate_cbs_ctx` on `cdf` with context `ctx`. */
+void rvg_pool_generate_cbs_ctx(struct rvg_pool * pool, cdf32_ctx_t cdf, const void * ctx,
+    double * out, size_t n);
+
+/** Fill `out` with `n` variates from `generate_cbs_ext_ctx` on `ddf` with context `ctx`. */
+void rvg_pool_generate_cbs_ext_ctx(struct rvg_pool * pool, ddf32_ctx_t ddf, const void * ctx,
+    double * out, size_t n);
+
+#endif
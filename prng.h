@@ -8,10 +8,46 @@
 #ifndef PRNG_H
 #define PRNG_H
 
+#include <stdint.h>
 #include <sys/random.h>
 #include <gsl/gsl_rng.h>
 
+#include "flip.h"
+
 GSL_VAR const gsl_rng_type *gsl_rng_deterministic;
 GSL_VAR const gsl_rng_type *gsl_rng_urandom;
+GSL_VAR const gsl_rng_type *gsl_rng_urandom_buffered;
+GSL_VAR const gsl_rng_type *gsl_rng_philox;
+
+// Capacity and default fill size, in 64-bit words, of the buffer of a
+// `gsl_rng_urandom_buffered` (64 KiB and 4 KiB).
+#define URANDOM_BUFFER_WORDS 8192
+#define URANDOM_BUFFER_DEFAULT_WORDS 512
+
+/** Set the number of bytes that a `gsl_rng_urandom_buffered` reads per
+    syscall, which is rounded down to a multiple of 8 in [8, 65536]. */
+void urandom_buffered_set_size(gsl_rng * rng, size_t bytes);
+
+// Fill `words` with `n` words from the state of a `gsl_rng_philox`, as a
+// `flip_fill_t` that avoids the indirect call of `gsl_rng_get` per word.
+void philox_fill(void * vstate, unsigned long * words, size_t n);
+
+// Fill `words` with `n` words of system entropy in one getrandom(2) call, as
+// a `flip_fill_t` for `gsl_rng_urandom` (whose `source` is unused).
+void urandom_fill_words(void * source, unsigned long * words, size_t n);
+
+/** Encrypt the 128-bit counter (`block`, `stream`) under `key` with
+    Philox4x32-10, giving words 2 block and 2 block + 1 of stream `stream`
+    of the seed key[0] + key[1] 2^32 in `output`. */
+void philox_block(const uint32_t key[2], uint64_t block, uint64_t stream, uint64_t output[2]);
+
+/** Position a `gsl_rng_philox` at word `offset` of stream `stream` of `seed`. */
+void philox_set(gsl_rng * rng, uint64_t seed, uint64_t stream, uint64_t offset);
+
+/** Position a `gsl_rng_philox` at word `offset` of its current stream. */
+void philox_seek(gsl_rng * rng, uint64_t offset);
+
+/** Position a `flip_state` over a `gsl_rng_philox` at bit `offset`. */
+void philox_flip_seek(struct flip_state * prng, uint64_t offset);
 
 #endif
@@ -0,0 +1,131 @@
+/*
+  Name:     philox.c
+  Purpose:  GSL compatible counter-based random number generator.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <gsl/gsl_rng.h>
+
+#include "flip.h"
+#include "prng.h"
+
+/* This generator is Philox4x32-10 from Salmon et al., "Parallel Random
+    Numbers: As Easy as 1, 2, 3" (SC 2011).
+
+    Word j of stream s for seed k is half of the block obtained by
+    encrypting the 128-bit counter (j / 2, s) under the 64-bit key k, so
+    that every stream is independent and every position is reachable in
+    constant time. */
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+#define PHILOX_ROUNDS 10
+
+static inline unsigned long int philox_get (void *vstate);
+static double philox_get_double (void *vstate);
+static void philox_set_seed (void *state, unsigned long int s);
+
+typedef struct {
+    uint32_t key[2];        // Seed.
+    uint64_t stream;        // High 64 bits of the counter.
+    uint64_t block;         // Low 64 bits of the counter.
+    uint64_t output[2];     // Output of the current block.
+    unsigned int pos;       // Next word in the output, 2 if empty.
+} philox_state_t;
+
+inline void
+philox_block (const uint32_t key[2], uint64_t block, uint64_t stream, uint64_t output[2]) {
+    uint32_t c[4] = {block, block >> 32, stream, stream >> 32};
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+    for (int r = 0; r < PHILOX_ROUNDS; r++) {
+        uint64_t p0 = (uint64_t) PHILOX_M0 * c[0];
+        uint64_t p1 = (uint64_t) PHILOX_M1 * c[2];
+        uint32_t d0 = (p1 >> 32) ^ c[1] ^ k0;
+        uint32_t d2 = (p0 >> 32) ^ c[3] ^ k1;
+        c[0] = d0;
+        c[1] = (uint32_t) p1;
+        c[2] = d2;
+        c[3] = (uint32_t) p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    output[0] = ((uint64_t) c[1] << 32) | c[0];
+    output[1] = ((uint64_t) c[3] << 32) | c[2];
+}
+
+static inline unsigned long int
+philox_get (void *vstate) {
+    philox_state_t *state = (philox_state_t *) vstate;
+    if (state->pos == 2) {
+        philox_block(state->key, state->block, state->stream, state->output);
+        state->block++;
+        state->pos = 0;
+    }
+    return state->output[state->pos++];
+}
+
+static double
+philox_get_double (void *vstate) {
+    return (philox_get (vstate) >> 11) * 0x1p-53;
+}
+
+static void
+philox_set_seed (void *vstate, unsigned long int s) {
+    philox_state_t *state = (philox_state_t *) vstate;
+    state->key[0] = s;
+    state->key[1] = (uint64_t) s >> 32;
+    state->stream = 0;
+    state->block = 0;
+    state->pos = 2;
+}
+
+static const gsl_rng_type philox_type = {
+    "philox",                      /* name */
+    0xffffffffffffffffUL,          /* RAND_MAX */
+    0,                             /* RAND_MIN */
+    sizeof (philox_state_t),
+    &philox_set_seed,
+    &philox_get,
+    &philox_get_double
+};
+
+const gsl_rng_type *gsl_rng_philox = &philox_type;
+
+void philox_fill(void * vstate, unsigned long * words, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        words[i] = philox_get(vstate);
+    }
+}
+
+void philox_set(gsl_rng * rng, uint64_t seed, uint64_t stream, uint64_t offset) {
+    assert(rng->type == gsl_rng_philox);
+    philox_set_seed(rng->state, seed);
+    ((philox_state_t *) rng->state)->stream = stream;
+    philox_seek(rng, offset);
+}
+
+void philox_seek(gsl_rng * rng, uint64_t offset) {
+    assert(rng->type == gsl_rng_philox);
+    philox_state_t *state = (philox_state_t *) rng->state;
+    state->block = offset / 2;
+    state->pos = 2;
+    if (offset % 2) {
+        philox_get(state);
+    }
+}
+
+void philox_flip_seek(struct flip_state * prng, uint64_t offset) {
+    assert(prng->buffer_size == 64);
+    philox_seek(prng->rng, offset / 64);
+    flip_reset(prng);
+    prng->num_flips = offset - offset % 64;
+    if (offset % 64) {
+        flip_k(prng, offset % 64);
+    }
+}
@@ -5,7 +5,9 @@
   Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
 */
 
+#include <assert.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -27,12 +29,12 @@ typedef struct {
     // No state is maintained.
 } urandom_state_t;
 
-static inline unsigned long int
-urandom_get (void *vstate) {
-    unsigned char buffer[sizeof(uint64_t)];
+// Fill `buffer` with `size` bytes of system entropy.
+static void
+urandom_fill (void *buffer, size_t size) {
     size_t offset = 0;
-    while (offset < sizeof(buffer)) {
-        ssize_t nread = getrandom(buffer + offset, sizeof(buffer) - offset, 0);
+    while (offset < size) {
+        ssize_t nread = getrandom((unsigned char *) buffer + offset, size - offset, 0);
         if (nread == -1) {
             if (errno == EINTR) { continue; }
             abort();
@@ -40,6 +42,12 @@ urandom_get (void *vstate) {
         if (nread == 0) { abort(); }
         offset += (size_t)nread;
     }
+}
+
+static inline unsigned long int
+urandom_get (void *vstate) {
+    unsigned char buffer[sizeof(uint64_t)];
+    urandom_fill(buffer, sizeof(buffer));
     uint64_t value = 0;
     memcpy(&value, buffer, sizeof(buffer));
     return value;
@@ -66,3 +74,93 @@ static const gsl_rng_type urandom_type = {
 };
 
 const gsl_rng_type *gsl_rng_urandom = &urandom_type;
+
+void urandom_fill_words(void * source, unsigned long * words, size_t n) {
+    urandom_fill(words, n * sizeof(unsigned long));
+}
+
+/* This generator serves words from a buffer that is refilled by a single
+    getrandom(2) call every URANDOM_BUFFER_DEFAULT_WORDS words (see
+    `urandom_buffered_set_size`), which amortizes the cost of the syscall.
+
+    The buffer is discarded in a child process after fork(2), so that the
+    parent and child never return the same words. Likewise, the buffer is
+    discarded in a copy of the state made by gsl_rng_clone or gsl_rng_memcpy,
+    which is detected by the address of the state, so that the copy and the
+    original never return the same words. Calling gsl_rng_set also discards
+    the buffer and restores the default fill size. */
+
+static inline unsigned long int urandom_buffered_get (void *vstate);
+static double urandom_buffered_get_double (void *vstate);
+static void urandom_buffered_set (void *state, unsigned long int s);
+
+typedef struct {
+    unsigned long fork_epoch;               // Value of urandom_fork_epoch at fill.
+    const void * owner;                     // Address of the state at fill.
+    size_t size;                            // Number of words per fill.
+    size_t pos;                             // Next word in the buffer.
+    uint64_t buffer[URANDOM_BUFFER_WORDS];
+} urandom_buffered_state_t;
+
+// Incremented in the child process after each fork.
+static unsigned long urandom_fork_epoch = 0;
+static pthread_once_t urandom_fork_once = PTHREAD_ONCE_INIT;
+
+static void
+urandom_fork_child (void) {
+    urandom_fork_epoch++;
+}
+
+static void
+urandom_fork_register (void) {
+    if (pthread_atfork(NULL, NULL, &urandom_fork_child) != 0) { abort(); }
+}
+
+static inline unsigned long int
+urandom_buffered_get (void *vstate) {
+    urandom_buffered_state_t *state = (urandom_buffered_state_t *) vstate;
+    if ((state->pos == state->size)
+            || (state->fork_epoch != urandom_fork_epoch)
+            || (state->owner != state)) {
+        urandom_fill(state->buffer, state->size * sizeof(uint64_t));
+        state->fork_epoch = urandom_fork_epoch;
+        state->owner = state;
+        state->pos = 0;
+    }
+    return state->buffer[state->pos++];
+}
+
+static double
+urandom_buffered_get_double (void *vstate) {
+  return urandom_buffered_get (vstate) / 18446744073709551616.0 ;
+}
+
+static void
+urandom_buffered_set (void *vstate, unsigned long int s) {
+    urandom_buffered_state_t *state = (urandom_buffered_state_t *) vstate;
+    pthread_once(&urandom_fork_once, &urandom_fork_register);
+    state->size = URANDOM_BUFFER_DEFAULT_WORDS;
+    state->pos = state->size;
+}
+
+static const gsl_rng_type urandom_buffered_type = {
+    "urandom_buffered",            /* name */
+    0xffffffffffffffffUL,          /* RAND_MAX */
+    0,                             /* RAND_MIN */
+    sizeof (urandom_buffered_state_t),
+    &urandom_buffered_set,
+    &urandom_buffered_get,
+    &urandom_buffered_get_double
+};
+
+const gsl_rng_type *gsl_rng_urandom_buffered = &urandom_buffered_type;
+
+void urandom_buffered_set_size(gsl_rng * rng, size_t bytes) {
+    assert(rng->type == gsl_rng_urandom_buffered);
+    urandom_buffered_state_t *state = (urandom_buffered_state_t *) rng->state;
+    size_t size = bytes / sizeof(uint64_t);
+    if (size < 1) { size = 1; }
+    if (URANDOM_BUFFER_WORDS < size) { size = URANDOM_BUFFER_WORDS; }
+    state->size = size;
+    state->pos = size;
+}
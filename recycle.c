@@ -0,0 +1,259 @@
+/*
+  Name:     recycle.c
+  Purpose:  Generate random variates that recycle randomness across draws.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arithmetic.h"
+#include "bernoulli.h"
+#include "bits.h"
+#include "flip.h"
+#include "generate.h"
+#include "generate_inline.h"
+#include "recycle.h"
+
+// The generators below walk the lex tree as `generate_cbs` does, choosing
+// the child b+'1' of a non-trivial node with probability a1/n, where a1 and
+// n are the masses of b+'1' and b, in units of their greatest common power
+// of two. Instead of flipping a fresh coin with this ratio, each choice
+// consumes part of a uniform state z over [0, m): if z < q n for q = m / n,
+// then the choice is decided by the residue t = z mod n, and the quotient
+// z / n together with the offset of t within the range of the chosen child
+// is again uniform, over [0, q a_i). Otherwise, z - q n is uniform over the
+// remaining range [0, m - q n). The state is refilled with flips whenever m
+// is below 2^RECYCLE_REFILL_BITS, so the probability of the second case is
+// below 2^(RECYCLE_SPLIT_BITS - RECYCLE_REFILL_BITS), and the bits drawn per
+// variate approach the Shannon entropy of the output. The few choices whose
+// n has more than RECYCLE_SPLIT_BITS bits flip a fresh coin with
+// `bernoulli_fix` instead.
+
+void rvg_recycler_init(struct rvg_recycler * r) {
+    r->z = 0;
+    r->m = 1;
+    r->samples = 0;
+    r->flips = 0;
+    r->info = 0;
+}
+
+// Number of leading zeros of a nonzero 128-bit x.
+static inline unsigned int clz128(unsigned __int128 x) {
+    uint64_t hi = x >> 64;
+    return (hi != 0) ? __builtin_clzll(hi) : 64 + __builtin_clzll((uint64_t) x);
+}
+
+// Append flips to the uniform state until m has 128 bits.
+static inline void recycle_refill(struct rvg_recycler * r, struct flip_state * prng) {
+    if (r->m >> RECYCLE_REFILL_BITS) { return; }
+    unsigned int k = clz128(r->m);
+    while (0 < k) {
+        unsigned int j = (k < 64) ? k : 64;
+        unsigned __int128 bits = flip_bits(prng, j);
+        r->z = (r->z << j) | bits;
+        r->m <<= j;
+        k -= j;
+    }
+}
+
+// Return 1 with probability 1 - a0/n, from the uniform state.
+static unsigned char recycle_split(struct rvg_recycler * r, unsigned __int128 a0,
+        unsigned __int128 n, struct flip_state * prng) {
+    assert((0 < a0) && (a0 < n));
+    while (1) {
+        recycle_refill(r, prng);
+        unsigned __int128 q = r->m / n;
+        unsigned __int128 qn = q * n;
+        if (r->z < qn) {
+            unsigned __int128 zq = r->z / n;
+            unsigned __int128 t = r->z - zq * n;
+            if (t < a0) {
+                r->z = zq * a0 + t;
+                r->m = q * a0;
+                return 0;
+            } else {
+                r->z = zq * (n - a0) + (t - a0);
+                r->m = q * (n - a0);
+                return 1;
+            }
+        }
+        r->z -= qn;
+        r->m -= qn;
+    }
+}
+
+// Choose a child of the node with cumulative masses fix_l < fix_m < fix_r.
+static unsigned char recycle_choose(struct rvg_recycler * r, const fix_t fix_l,
+        const fix_t fix_m, const fix_t fix_r, struct flip_state * prng) {
+    fix_t a0, a1, n;
+    fix_sub(fix_m, fix_l, a0);
+    fix_sub(fix_r, fix_l, n);
+    unsigned int k0 = fix_ctz(a0);
+    unsigned int kn = fix_ctz(n);
+    unsigned int k = (k0 < kn) ? k0 : kn;
+    fix_t a0_k = {a0[0], a0[1], a0[2]};
+    fix_t n_k = {n[0], n[1], n[2]};
+    fix_shr(a0_k, k);
+    fix_shr(n_k, k);
+    if ((n_k[2] == 0) && ((n_k[1] >> (RECYCLE_SPLIT_BITS - 64)) == 0)) {
+        unsigned __int128 a0_w = ((unsigned __int128) a0_k[1] << 64) | a0_k[0];
+        unsigned __int128 n_w = ((unsigned __int128) n_k[1] << 64) | n_k[0];
+        return recycle_split(r, a0_w, n_w, prng);
+    }
+    fix_sub(fix_r, fix_m, a1);
+    return bernoulli_fix(a1, n, prng);
+}
+
+// Record a variate whose mass is fix_r - fix_l.
+static void recycle_record(struct rvg_recycler * r, const fix_t fix_l, const fix_t fix_r,
+        unsigned long num_flips, struct flip_state * prng) {
+    fix_t w;
+    fix_sub(fix_r, fix_l, w);
+    r->samples += 1;
+    r->flips += prng->num_flips - num_flips;
+    r->info -= log2(fix_to_double(w));
+}
+
+// Body of `rvg_recycler_generate` and its variants, which walks the lex
+// tree of `ddf` with context `ctx`.
+static inline double recycle_generate_common(struct rvg_recycler * r, ddf32_ctx_t ddf,
+        const void * ctx, struct flip_state * prng) {
+
+    // Evolving state.
+    uint64_t b = 0;
+    bool d_l = 0; float cdf_l = 0;
+    bool d_r = 1; float cdf_r = 0;
+    unsigned long num_flips = prng->num_flips;
+
+    // Fixed-point objects.
+    fix_t fix_l, fix_m, fix_r;
+
+    RVG_STATS_BEGIN(prng);
+
+    for (int l = 0; l < DBL_SIZE; l++) {
+
+        // Compute DDF at midpoint.
+        unsigned int m = DBL_SIZE - (l + 1);             // m = n_max - (len(b)+1)
+        uint64_t b_lex = (b << (m + 1)) + (1ull << m) - 1; // b+'0' + '1'*m
+        uint64_t b_flt = bij64_lex2float(b_lex);
+        double d = int2double(b_flt);
+        bool d_m; float cdf_m;
+        ddf(d, ctx, &d_m, &cdf_m);
+        RVG_STATS_ADD(cdf_calls, 1);
+        assert(compare_lte_ext(d_l, cdf_l, d_m, cdf_m));
+        assert(compare_lte_ext(d_m, cdf_m, d_r, cdf_r));
+
+        // Compute b+'0' and b+'1'.
+        uint64_t b_lex_0 = b << 1;
+        uint64_t b_lex_1 = b_lex_0 | 1;
+
+        // Trivial case.
+        if ((d_m == d_r) && (cdf_m == cdf_r)) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
+            b = b_lex_0;
+            d_r = d_m; cdf_r = cdf_m;
+            continue;
+        }
+        if ((d_m == d_l) && (cdf_m == cdf_l)) {
+            RVG_STATS_LEVEL(RVG_TRACE_TRIVIAL, l, 0);
+            b = b_lex_1;
+            d_l = d_m; cdf_l = cdf_m;
+            continue;
+        }
+
+        // Non-trivial case.
+        fix_from_ddf(d_l, cdf_l, fix_l);
+        fix_from_ddf(d_m, cdf_m, fix_m);
+        fix_from_ddf(d_r, cdf_r, fix_r);
+        unsigned char z = recycle_choose(r, fix_l, fix_m, fix_r, prng);
+        RVG_STATS_LEVEL(RVG_TRACE_SPLIT, l, 0);
+        if (z == 0) {
+            b = b_lex_0;
+            d_r = d_m; cdf_r = cdf_m;
+        } else {
+            b = b_lex_1;
+            d_l = d_m; cdf_l = cdf_m;
+        }
+    }
+
+    fix_from_ddf(d_l, cdf_l, fix_l);
+    fix_from_ddf(d_r, cdf_r, fix_r);
+    recycle_record(r, fix_l, fix_r, num_flips, prng);
+    RVG_STATS_SAMPLE(prng, DBL_SIZE, 0);
+
+    b = bij64_lex2float(b);
+    return int2double(b);
+}
+
+// The walk only uses the exact value of the target at each node, so a CDF
+// value c is passed as the DDF value (0, c) if c <= 1/2 and (1, 1 - c)
+// otherwise, where 1 - c is exact. The fixed-point values, and therefore
+// the choices and the flips, are those of the CDF.
+struct recycle_cdf {
+    cdf32_ctx_t cdf;
+    const void * ctx;
+};
+
+static inline void recycle_ddf_of_cdf(double x, const void * ctx, bool * d, float * q) {
+    const struct recycle_cdf * f = ctx;
+    float c = f->cdf(x, f->ctx);
+    *d = (0.5f < c);
+    *q = *d ? 1 - c : c;
+}
+
+double rvg_recycler_generate(struct rvg_recycler * r, cdf32_t cdf, struct flip_state * prng) {
+    return rvg_recycler_generate_ctx(r, cdf_plain, &cdf, prng);
+}
+
+double rvg_recycler_generate_ext(struct rvg_recycler * r, ddf32_t ddf, struct flip_state * prng) {
+    return recycle_generate_common(r, ddf_plain, &ddf, prng);
+}
+
+double rvg_recycler_generate_ctx(struct rvg_recycler * r, cdf32_ctx_t cdf, const void * ctx,
+        struct flip_state * prng) {
+    struct recycle_cdf f = {.cdf = cdf, .ctx = ctx};
+    return recycle_generate_common(r, recycle_ddf_of_cdf, &f, prng);
+}
+
+double rvg_recycler_generate_ext_ctx(struct rvg_recycler * r, ddf32_ctx_t ddf, const void * ctx,
+        struct flip_state * prng) {
+    return recycle_generate_common(r, ddf, ctx, prng);
+}
+
+void rvg_recycler_generate_n(struct rvg_recycler * r, cdf32_t cdf, struct flip_state * prng,
+        double * out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = rvg_recycler_generate(r, cdf, prng);
+    }
+}
+
+void rvg_recycler_generate_n_ext(struct rvg_recycler * r, ddf32_t ddf, struct flip_state * prng,
+        double * out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = rvg_recycler_generate_ext(r, ddf, prng);
+    }
+}
+
+void rvg_recycler_generate_n_ctx(struct rvg_recycler * r, cdf32_ctx_t cdf, const void * ctx,
+        struct flip_state * prng, double * out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = rvg_recycler_generate_ctx(r, cdf, ctx, prng);
+    }
+}
+
+void rvg_recycler_generate_n_ext_ctx(struct rvg_recycler * r, ddf32_ctx_t ddf, const void * ctx,
+        struct flip_state * prng, double * out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = rvg_recycler_generate_ext_ctx(r, ddf, ctx, prng);
+    }
+}
+
+void rvg_recycler_report(const struct rvg_recycler * r, double * bits, double * bound) {
+    *bits = (r->samples == 0) ? 0 : (double) r->flips / r->samples;
+    *bound = (r->samples == 0) ? 0 : r->info / r->samples;
+}
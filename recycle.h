@@ -0,0 +1,73 @@
+/*
+  Name:     recycle.h
+  Purpose:  Generate random variates that recycle randomness across draws.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#ifndef RECYCLE_H
+#define RECYCLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flip.h"
+#include "generate.h"
+
+// Number of bits below which the uniform state is refilled from the flips.
+#define RECYCLE_REFILL_BITS 120
+
+// Number of bits of the largest ratio denominator resolved from the state.
+#define RECYCLE_SPLIT_BITS 96
+
+/** A generator that keeps a uniform state between draws, so that the bits
+    left over by one draw are used by the next. */
+struct rvg_recycler {
+    unsigned __int128 z;    // Uniform over [0, m), independent of all outputs.
+    unsigned __int128 m;
+    uint64_t samples;       // Number of variates generated.
+    uint64_t flips;         // Bits drawn from the flip_state (see FLIP_NO_COUNT).
+    double info;            // Sum of -log2 Pr(X = x) over the variates x.
+};
+
+/** Initialize a `rvg_recycler` with an empty uniform state. */
+void rvg_recycler_init(struct rvg_recycler * r);
+
+/** Generate a random variable from `cdf`, recycling randomness. */
+double rvg_recycler_generate(struct rvg_recycler * r, cdf32_t cdf, struct flip_state * prng);
+
+/** Generate a random variable from `ddf`, recycling randomness. */
+double rvg_recycler_generate_ext(struct rvg_recycler * r, ddf32_t ddf, struct flip_state * prng);
+
+/** Generate `n` random variables from `cdf` into `out`, recycling randomness. */
+void rvg_recycler_generate_n(struct rvg_recycler * r, cdf32_t cdf, struct flip_state * prng,
+    double * out, size_t n);
+
+/** Generate `n` random variables from `ddf` into `out`, recycling randomness. */
+void rvg_recycler_generate_n_ext(struct rvg_recycler * r, ddf32_t ddf, struct flip_state * prng,
+    double * out, size_t n);
+
+/** Generate a random variable from `cdf` with context `ctx`, recycling randomness. */
+double rvg_recycler_generate_ctx(struct rvg_recycler * r, cdf32_ctx_t cdf, const void * ctx,
+    struct flip_state * prng);
+
+/** Generate a random variable from `ddf` with context `ctx`, recycling randomness. */
+double rvg_recycler_generate_ext_ctx(struct rvg_recycler * r, ddf32_ctx_t ddf, const void * ctx,
+    struct flip_state * prng);
+
+/** Generate `n` random variables from `cdf` with context `ctx` into `out`,
+    recycling randomness. */
+void rvg_recycler_generate_n_ctx(struct rvg_recycler * r, cdf32_ctx_t cdf, const void * ctx,
+    struct flip_state * prng, double * out, size_t n);
+
+/** Generate `n` random variables from `ddf` with context `ctx` into `out`,
+    recycling randomness. */
+void rvg_recycler_generate_n_ext_ctx(struct rvg_recycler * r, ddf32_ctx_t ddf, const void * ctx,
+    struct flip_state * prng, double * out, size_t n);
+
+/** Store the bits drawn per variate in `bits` and the average information
+    -log2 Pr(X = x) of the variates, which estimates the Shannon entropy
+    bound on `bits`, in `bound`. */
+void rvg_recycler_report(const struct rvg_recycler * r, double * bits, double * bound);
+
+#endif
@@ -0,0 +1,238 @@
+/*
+  Name:     sampler.c
+  Purpose:  Persistent generator that memoizes CDF evaluations.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include "bits.h"
+#include "flip.h"
+#include "arithmetic.h"
+#include "generate.h"
+#include "generate_inline.h"
+#include "sampler.h"
+
+// The trie stores the top of the lex tree of `generate_opt` (Section 5.2
+// of [SL25]). Each node (b, l) keeps the target at its midpoint together
+// with the exact expansions of the masses of b+'0' and b+'1'. A draw walks
+// the trie from the root, adds at most one new node at the frontier, and
+// finishes the descent with `generate_opt_node`, so the trie grows toward
+// the most probable paths. When the trie is full, a CLOCK sweep evicts a
+// leaf whose visit count has decayed to zero.
+
+// A plain target `cdf32` or `ddf32` is stored in the sampler, which is
+// then the context of the adapter `cdf` or `ddf`.
+static struct rvg_sampler * sampler_alloc_common(
+        cdf32_ctx_t cdf,
+        ddf32_ctx_t ddf,
+        const void * ctx,
+        cdf32_t cdf32,
+        ddf32_t ddf32,
+        size_t max_bytes
+        ) {
+    struct rvg_sampler * sampler = malloc(sizeof(*sampler));
+    if (sampler == NULL) { return NULL; }
+    size_t max_nodes = max(max_bytes / sizeof(struct sampler_node), (size_t)2);
+    if (INT32_MAX < max_nodes) { max_nodes = INT32_MAX; }
+    sampler->nodes = malloc(max_nodes * sizeof(struct sampler_node));
+    if (sampler->nodes == NULL) { free(sampler); return NULL; }
+    sampler->cdf = cdf;
+    sampler->ddf = ddf;
+    sampler->cdf32 = cdf32;
+    sampler->ddf32 = ddf32;
+    sampler->ctx = (cdf32 != NULL) ? (const void *) &sampler->cdf32
+        : (ddf32 != NULL) ? (const void *) &sampler->ddf32
+        : ctx;
+    sampler->max_nodes = max_nodes;
+    sampler->num_nodes = 0;
+    sampler->clock = 0;
+    sampler->num_hits = 0;
+    sampler->num_misses = 0;
+    sampler->num_evictions = 0;
+    return sampler;
+}
+
+struct rvg_sampler * rvg_sampler_alloc(cdf32_t cdf, size_t max_bytes) {
+    return sampler_alloc_common(cdf_plain, NULL, NULL, cdf, NULL, max_bytes);
+}
+
+struct rvg_sampler * rvg_sampler_alloc_ext(ddf32_t ddf, size_t max_bytes) {
+    return sampler_alloc_common(NULL, ddf_plain, NULL, NULL, ddf, max_bytes);
+}
+
+struct rvg_sampler * rvg_sampler_alloc_ctx(cdf32_ctx_t cdf, const void * ctx, size_t max_bytes) {
+    return sampler_alloc_common(cdf, NULL, ctx, NULL, NULL, max_bytes);
+}
+
+struct rvg_sampler * rvg_sampler_alloc_ext_ctx(ddf32_ctx_t ddf, const void * ctx, size_t max_bytes) {
+    return sampler_alloc_common(NULL, ddf, ctx, NULL, NULL, max_bytes);
+}
+
+void rvg_sampler_free(struct rvg_sampler * sampler) {
+    free(sampler->nodes);
+    free(sampler);
+}
+
+void rvg_sampler_clear(struct rvg_sampler * sampler) {
+    sampler->num_nodes = 0;
+    sampler->clock = 0;
+}
+
+// Evaluate the node (b, l), whose endpoints have values (d_l, cdf_l)
+// and (d_r, cdf_r), and store it in slot `i` of the trie.
+static void sampler_expand(
+        struct rvg_sampler * sampler
+        , int32_t i
+        , int32_t parent
+        , uint64_t b
+        , unsigned int l
+        , bool d_l, float cdf_l
+        , bool d_r, float cdf_r
+        ) {
+
+    struct sampler_node * node = &sampler->nodes[i];
+    node->child[0] = 0;
+    node->child[1] = 0;
+    node->parent = parent;
+    node->visits = 0;
+
+    // Compute CDF at midpoint.
+    unsigned int m = DBL_SIZE - (l + 1);             // m = n_max - (len(b)+1)
+    uint64_t b_lex = (b << (m + 1)) + (1ull << m) - 1; // b+'0' + '1'*m
+    uint64_t b_flt = bij64_lex2float(b_lex);
+    double d = int2double(b_flt);
+    if (sampler->cdf != NULL) {
+        node->d_m = 0;
+        node->cdf_m = sampler->cdf(d, sampler->ctx);
+        RVG_STATS_ADD(cdf_calls, 1);
+        assert(cdf_l <= node->cdf_m);
+        assert(node->cdf_m <= cdf_r);
+    } else {
+        sampler->ddf(d, sampler->ctx, &node->d_m, &node->cdf_m);
+        RVG_STATS_ADD(cdf_calls, 1);
+        assert(compare_lte_ext(d_l, cdf_l, node->d_m, node->cdf_m));
+        assert(compare_lte_ext(node->d_m, node->cdf_m, d_r, cdf_r));
+    }
+
+    // Trivial case.
+    if ((node->d_m == d_r) && (node->cdf_m == cdf_r)) {
+        node->kind = SAMPLER_LEFT;
+        return;
+    }
+    if ((node->d_m == d_l) && (node->cdf_m == cdf_l)) {
+        node->kind = SAMPLER_RIGHT;
+        return;
+    }
+
+    // Finite arithmetic case.
+    node->kind = SAMPLER_SPLIT;
+    if (sampler->cdf != NULL) {
+        subtract_exact(SUB_0, node->cdf_m, cdf_l, &node->ss0);
+        subtract_exact(SUB_0, cdf_r, node->cdf_m, &node->ss1);
+    } else {
+        subtract_exact_ext(node->d_m, node->cdf_m, d_l, cdf_l, &node->ss0);
+        subtract_exact_ext(d_r, cdf_r, node->d_m, node->cdf_m, &node->ss1);
+    }
+}
+
+// Obtain a free slot in the trie, evicting a cold leaf other than `keep`
+// if the trie is full. Returns -1 if there is no such leaf. Visit counts
+// are at most UCHAR_MAX, so every leaf is evictable after CHAR_BIT sweeps.
+static int32_t sampler_slot(struct rvg_sampler * sampler, int32_t keep) {
+    if (sampler->num_nodes < sampler->max_nodes) {
+        return sampler->num_nodes++;
+    }
+    for (size_t k = 0; k < (CHAR_BIT + 1) * sampler->max_nodes; k++) {
+        size_t j = sampler->clock;
+        sampler->clock = (j + 1) % sampler->max_nodes;
+        struct sampler_node * node = &sampler->nodes[j];
+        if ((j == 0) || (j == keep) || node->child[0] || node->child[1]) {
+            continue;
+        }
+        if (node->visits > 0) {
+            node->visits >>= 1;
+            continue;
+        }
+        struct sampler_node * parent = &sampler->nodes[node->parent];
+        parent->child[parent->child[1] == j] = 0;
+        sampler->num_evictions += 1;
+        return j;
+    }
+    return -1;
+}
+
+double rvg_sampler_generate_opt(struct rvg_sampler * sampler, struct flip_state * prng) {
+
+    // Evolving state.
+    uint64_t b = 0;
+    unsigned int ell = 0;
+    bool ext = (sampler->cdf == NULL);
+    bool d_l = 0; float cdf_l = 0;
+    bool d_r = ext; float cdf_r = ext ? 0 : 1;
+    bool grown = false;
+
+    RVG_STATS_BEGIN(prng);
+
+    // Locate the root.
+    if (sampler->num_nodes == 0) {
+        sampler_expand(sampler, sampler_slot(sampler, 0), 0, b, 0, d_l, cdf_l, d_r, cdf_r);
+        grown = true;
+    }
+
+    int32_t i = 0;
+    for (unsigned int l = 0; l < DBL_SIZE; l++) {
+
+        struct sampler_node * node = &sampler->nodes[i];
+        node->visits += (node->visits < UCHAR_MAX);
+        sampler->num_hits += !grown;
+        sampler->num_misses += grown;
+
+        // Choose the next bit.
+        unsigned char z;
+        switch (node->kind) {
+            case SAMPLER_LEFT:  z = 0; break;
+            case SAMPLER_RIGHT: z = 1; break;
+            default:            z = generate_opt_split(&node->ss0, &node->ss1, &ell, prng);
+        }
+        RVG_STATS_LEVEL((node->kind == SAMPLER_SPLIT) ? RVG_TRACE_SPLIT : RVG_TRACE_TRIVIAL, l, ell);
+
+        // Move to b+'z'.
+        b = (b << 1) | z;
+        if (z == 0) {
+            d_r = node->d_m; cdf_r = node->cdf_m;
+        } else {
+            d_l = node->d_m; cdf_l = node->cdf_m;
+        }
+        if (l + 1 == DBL_SIZE) {
+            break;
+        }
+
+        // Grow the trie by at most one node, else finish without it.
+        if (node->child[z] == 0) {
+            int32_t j = grown ? -1 : sampler_slot(sampler, i);
+            if (j < 0) {
+                // The variate is recorded by `generate_opt_node`, which
+                // counts the flips from here on.
+                sampler->num_misses += DBL_SIZE - (l + 1);
+                RVG_STATS_ADD(flips, prng->num_flips - rvg_stats_flips__);
+                return ext
+                    ? generate_opt_node_ext_ctx(sampler->ddf, sampler->ctx, b, l + 1, ell,
+                        d_l, cdf_l, d_r, cdf_r, prng)
+                    : generate_opt_node_ctx(sampler->cdf, sampler->ctx, b, l + 1, ell,
+                        cdf_l, cdf_r, prng);
+            }
+            sampler_expand(sampler, j, i, b, l + 1, d_l, cdf_l, d_r, cdf_r);
+            node->child[z] = j;
+            grown = true;
+        }
+        i = node->child[z];
+    }
+
+    RVG_STATS_SAMPLE(prng, DBL_SIZE, ell);
+    b = bij64_lex2float(b);
+    return int2double(b);
+}
@@ -0,0 +1,78 @@
+/*
+  Name:     sampler.h
+  Purpose:  Persistent generator that memoizes CDF evaluations.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arithmetic.h"
+#include "flip.h"
+#include "generate.h"
+
+// Default memory budget of the trie, in bytes.
+#define SAMPLER_DEFAULT_BYTES (1 << 20)
+
+// Classification of a node of the lex tree.
+enum sampler_kind {SAMPLER_LEFT, SAMPLER_RIGHT, SAMPLER_SPLIT};
+
+// Node of the trie, which stores the value of the target at the midpoint
+// b+'0'+'1'*m of the node (b, l) and, for a non-trivial split, the exact
+// binary expansions of the masses of its two children.
+struct sampler_node {
+    int32_t child[2];               // Index of child b+'0', b+'1' (0 if absent).
+    int32_t parent;                 // Index of the parent node.
+    unsigned char visits;           // Saturating visit count, for eviction.
+    bool d_m;                       // DDF direction at the midpoint.
+    float cdf_m;                    // CDF (or DDF) value at the midpoint.
+    unsigned char kind;             // Value of enum sampler_kind.
+    struct subtract_exact_s ss0;    // Mass of b+'0' (SAMPLER_SPLIT only).
+    struct subtract_exact_s ss1;    // Mass of b+'1' (SAMPLER_SPLIT only).
+};
+
+/** A generator for a fixed `cdf` or `ddf` that caches the lex tree. Every
+    draw updates its trie, so a sampler must not be shared across threads
+    without a lock. */
+struct rvg_sampler {
+    cdf32_ctx_t cdf;                // Target CDF (NULL if ddf is used).
+    ddf32_ctx_t ddf;                // Target DDF (NULL if cdf is used).
+    const void * ctx;               // Context of cdf or ddf.
+    cdf32_t cdf32;                  // Plain target CDF, pointed to by ctx (if any).
+    ddf32_t ddf32;                  // Plain target DDF, pointed to by ctx (if any).
+    struct sampler_node * nodes;    // Trie of visited nodes, root at index 0.
+    size_t num_nodes;               // Number of nodes in the trie.
+    size_t max_nodes;               // Capacity of the trie.
+    size_t clock;                   // Position of the eviction sweep.
+    unsigned long num_hits;         // Number of levels resolved from the trie.
+    unsigned long num_misses;       // Number of levels that called the target.
+    unsigned long num_evictions;    // Number of nodes evicted from the trie.
+};
+
+/** Allocate a sampler for `cdf` whose trie uses at most `max_bytes`. */
+struct rvg_sampler * rvg_sampler_alloc(cdf32_t cdf, size_t max_bytes);
+
+/** Allocate a sampler for `ddf` whose trie uses at most `max_bytes`. */
+struct rvg_sampler * rvg_sampler_alloc_ext(ddf32_t ddf, size_t max_bytes);
+
+/** Allocate a sampler for `cdf` with context `ctx`, which must outlive it. */
+struct rvg_sampler * rvg_sampler_alloc_ctx(cdf32_ctx_t cdf, const void * ctx, size_t max_bytes);
+
+/** Allocate a sampler for `ddf` with context `ctx`, which must outlive it. */
+struct rvg_sampler * rvg_sampler_alloc_ext_ctx(ddf32_ctx_t ddf, const void * ctx, size_t max_bytes);
+
+/** Free a sampler. */
+void rvg_sampler_free(struct rvg_sampler * sampler);
+
+/** Discard all cached nodes of a sampler. */
+void rvg_sampler_clear(struct rvg_sampler * sampler);
+
+/** Generate random variables optimally from a sampler. */
+double rvg_sampler_generate_opt(struct rvg_sampler * sampler, struct flip_state * prng);
+
+#endif
@@ -0,0 +1,42 @@
+/*
+  Name:     stats.c
+  Purpose:  Count the work done by the generators.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "flip.h"
+#include "stats.h"
+
+_Thread_local struct rvg_stats rvg_stats_local;
+_Thread_local rvg_trace_t rvg_trace_hook = NULL;
+_Thread_local void * rvg_trace_ctx = NULL;
+
+bool rvg_stats_enabled(void) {
+    #ifdef RVG_STATS
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+void rvg_stats_snapshot(struct rvg_stats * stats) {
+    *stats = rvg_stats_local;
+}
+
+void rvg_stats_reset(void) {
+    memset(&rvg_stats_local, 0, sizeof(rvg_stats_local));
+}
+
+void rvg_stats_set_trace(rvg_trace_t trace, void * ctx) {
+    rvg_trace_hook = trace;
+    rvg_trace_ctx = ctx;
+}
+
+extern inline void rvg_stats_level(enum rvg_trace_event event, unsigned int l, unsigned int ell);
+extern inline void rvg_stats_sample(struct flip_state * prng, unsigned long num_flips,
+    unsigned int l, unsigned int ell);
@@ -0,0 +1,106 @@
+/*
+  Name:     stats.h
+  Purpose:  Count the work done by the generators.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "flip.h"
+
+// Number of levels of the lex tree in the histogram of non-trivial levels.
+#define RVG_STATS_LEVELS 64
+
+// Events reported to the trace hook.
+enum rvg_trace_event {
+    RVG_TRACE_TRIVIAL,      // Trivial level of the lex tree.
+    RVG_TRACE_SPLIT,        // Non-trivial level of the lex tree.
+    RVG_TRACE_SAMPLE,       // End of a variate.
+};
+
+// Called at each `event` with the level `l` of the lex tree (the length of
+// the output for RVG_TRACE_SAMPLE) and the depth `ell` of the entropy-optimal
+// tree (0 for the Conditional Bit Sampling generators).
+typedef void (*rvg_trace_t)(void * ctx, enum rvg_trace_event event,
+    unsigned int l, unsigned int ell);
+
+/** Counters of the work done by the generators on a thread. */
+struct rvg_stats {
+    uint64_t samples;                           // Variates generated.
+    uint64_t cdf_calls;                         // Evaluations of the target.
+    uint64_t trivial;                           // Trivial levels.
+    uint64_t split;                             // Non-trivial levels.
+    uint64_t windows;                           // Windows of flips in generate_opt_split(64).
+    uint64_t flips;                             // Bits consumed (see FLIP_NO_COUNT).
+    uint64_t ell_max;                           // Maximum depth of the entropy-optimal tree.
+    uint64_t split_level[RVG_STATS_LEVELS];     // Non-trivial levels by level of the lex tree.
+};
+
+// Counters and trace hook of the calling thread.
+extern _Thread_local struct rvg_stats rvg_stats_local;
+extern _Thread_local rvg_trace_t rvg_trace_hook;
+extern _Thread_local void * rvg_trace_ctx;
+
+/** Whether the library was compiled with RVG_STATS, i.e., whether the
+    generators update the counters and call the trace hook. */
+bool rvg_stats_enabled(void);
+
+/** Copy the counters of the calling thread into `stats`. */
+void rvg_stats_snapshot(struct rvg_stats * stats);
+
+/** Set the counters of the calling thread to 0. */
+void rvg_stats_reset(void);
+
+/** Call `trace` with `ctx` at each event on the calling thread, or
+    disable the trace hook if `trace` is NULL. */
+void rvg_stats_set_trace(rvg_trace_t trace, void * ctx);
+
+// Record a level of the lex tree, where the histogram of non-trivial levels
+// only covers l < RVG_STATS_LEVELS (the tree of `generate_opt_uint` is
+// deeper). The external definition is in stats.c.
+inline void rvg_stats_level(enum rvg_trace_event event, unsigned int l, unsigned int ell) {
+    struct rvg_stats * s = &rvg_stats_local;
+    if (event == RVG_TRACE_TRIVIAL) {
+        s->trivial++;
+    } else {
+        s->split++;
+        if (l < RVG_STATS_LEVELS) { s->split_level[l]++; }
+        if (s->ell_max < ell) { s->ell_max = ell; }
+    }
+    if (rvg_trace_hook != NULL) {
+        rvg_trace_hook(rvg_trace_ctx, event, l, ell);
+    }
+}
+
+// Record the end of a variate that started with `num_flips` flips. The
+// external definition is in stats.c.
+inline void rvg_stats_sample(struct flip_state * prng, unsigned long num_flips,
+        unsigned int l, unsigned int ell) {
+    struct rvg_stats * s = &rvg_stats_local;
+    s->samples++;
+    s->flips += prng->num_flips - num_flips;
+    if (rvg_trace_hook != NULL) {
+        rvg_trace_hook(rvg_trace_ctx, RVG_TRACE_SAMPLE, l, ell);
+    }
+}
+
+// The generators are instrumented with the macros below, which compile to
+// nothing unless the library is compiled with RVG_STATS.
+#ifdef RVG_STATS
+#define RVG_STATS_BEGIN(prng)               unsigned long rvg_stats_flips__ = (prng)->num_flips
+#define RVG_STATS_ADD(field, k)             (rvg_stats_local.field += (k))
+#define RVG_STATS_LEVEL(event, l, ell)      rvg_stats_level((event), (l), (ell))
+#define RVG_STATS_SAMPLE(prng, l, ell)      rvg_stats_sample((prng), rvg_stats_flips__, (l), (ell))
+#else
+#define RVG_STATS_BEGIN(prng)               ((void) 0)
+#define RVG_STATS_ADD(field, k)             ((void) 0)
+#define RVG_STATS_LEVEL(event, l, ell)      ((void) 0)
+#define RVG_STATS_SAMPLE(prng, l, ell)      ((void) 0)
+#endif
+
+#endif
@@ -0,0 +1,611 @@
+/*
+  Name:     table.c
+  Purpose:  Memory-mappable tables of the top of the lex tree.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bits.h"
+#include "flip.h"
+#include "arithmetic.h"
+#include "generate.h"
+#include "generate_inline.h"
+#include "sampler.h"
+#include "table.h"
+
+// A table file holds the nodes of the top of the lex tree of a target in
+// the layout of `sampler_node` (see sampler.c), so that a process can
+// sample from the pages of a shared mapping without evaluating the target
+// near the root. All fields are little endian. The file consists of
+//
+//   header   64 bytes, see TABLE_OFF_* below.
+//   probes   num_probes records of 16 bytes: the bits of a midpoint x
+//            (8 bytes), and the value (4 bytes) and direction (4 bytes)
+//            of the target at x.
+//   nodes    num_nodes records of 72 bytes, as `struct table_node`.
+//
+// The probes fingerprint the target: they are hashed into the header and
+// re-evaluated on load. The nodes are hashed into the header, and checked
+// on load only when requested, since doing so reads every page. Both
+// hashes are 64-bit FNV-1a over the bytes of the file.
+
+#define TABLE_MAGIC         "RVGTABLE"
+#define TABLE_HEADER_SIZE   64
+#define TABLE_PROBE_SIZE    16
+#define TABLE_NODE_SIZE     72
+
+#define TABLE_OFF_MAGIC         0   // char[8]
+#define TABLE_OFF_VERSION       8   // uint32, RVG_TABLE_VERSION
+#define TABLE_OFF_EXT           12  // uint32, 1 if built from a DDF
+#define TABLE_OFF_NODE_SIZE     16  // uint32, TABLE_NODE_SIZE
+#define TABLE_OFF_NUM_PROBES    20  // uint32
+#define TABLE_OFF_NUM_NODES     24  // uint64
+#define TABLE_OFF_FINGERPRINT   32  // uint64, hash of the probes
+#define TABLE_OFF_CHECKSUM      40  // uint64, hash of the nodes
+
+_Static_assert(sizeof(struct subtract_exact_s) == 28, "layout of subtract_exact_s");
+_Static_assert(sizeof(struct table_node) == TABLE_NODE_SIZE, "layout of table_node");
+_Static_assert(offsetof(struct table_node, ss0) == 16, "layout of table_node");
+_Static_assert(offsetof(struct table_node, ss1) == 44, "layout of table_node");
+
+// ================ Encoding ================
+
+static void put_u32(unsigned char * p, uint32_t v) {
+    for (int i = 0; i < 4; i++) { p[i] = v >> (8 * i); }
+}
+
+static void put_u64(unsigned char * p, uint64_t v) {
+    for (int i = 0; i < 8; i++) { p[i] = v >> (8 * i); }
+}
+
+static uint32_t get_u32(const unsigned char * p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) { v |= (uint32_t) p[i] << (8 * i); }
+    return v;
+}
+
+static uint64_t get_u64(const unsigned char * p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) { v |= (uint64_t) p[i] << (8 * i); }
+    return v;
+}
+
+static uint32_t float_u32(float x) {
+    uint32_t v;
+    memcpy(&v, &x, sizeof(v));
+    return v;
+}
+
+static uint64_t double_u64(double x) {
+    uint64_t v;
+    memcpy(&v, &x, sizeof(v));
+    return v;
+}
+
+static uint64_t table_hash(const unsigned char * p, size_t n, uint64_t h) {
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+#define TABLE_HASH_INIT 0xcbf29ce484222325ull
+
+static void put_exact(unsigned char * p, const struct subtract_exact_s * ss) {
+    put_u32(p + 0, ss->n_1);
+    put_u32(p + 4, ss->n_2);
+    put_u32(p + 8, ss->n_hi);
+    put_u32(p + 12, ss->n_lo);
+    p[16] = (uint16_t) ss->b_1; p[17] = (uint16_t) ss->b_1 >> 8;
+    p[18] = (uint16_t) ss->b_2; p[19] = (uint16_t) ss->b_2 >> 8;
+    put_u32(p + 20, ss->g_hi);
+    put_u32(p + 24, ss->g_lo);
+}
+
+static void put_node(unsigned char * p, const struct table_node * node) {
+    memset(p, 0, TABLE_NODE_SIZE);
+    put_u32(p + 0, node->child[0]);
+    put_u32(p + 4, node->child[1]);
+    put_u32(p + 8, float_u32(node->cdf_m));
+    p[12] = node->d_m;
+    p[13] = node->kind;
+    put_exact(p + 16, &node->ss0);
+    put_exact(p + 44, &node->ss1);
+}
+
+// ================ Builder ================
+
+// A node of the lex tree whose parent is in the table, with its endpoints.
+struct table_frontier {
+    double mass;                    // Approximate probability of the node.
+    int32_t parent;
+    unsigned char z;                // The node is child z of the parent.
+    uint64_t b;
+    unsigned int l;
+    bool d_l; float cdf_l;
+    bool d_r; float cdf_r;
+};
+
+// Approximate position of the point (d, cdf) in [0, 1].
+static double table_position(bool d, float cdf) {
+    return d ? 1 - (double) cdf : (double) cdf;
+}
+
+// Max-heap of the frontier by mass.
+struct table_heap {
+    struct table_frontier * items;
+    size_t size;
+};
+
+static void heap_push(struct table_heap * heap, struct table_frontier f) {
+    size_t i = heap->size++;
+    while ((0 < i) && (heap->items[(i - 1) / 2].mass < f.mass)) {
+        heap->items[i] = heap->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->items[i] = f;
+}
+
+static struct table_frontier heap_pop(struct table_heap * heap) {
+    struct table_frontier top = heap->items[0];
+    struct table_frontier last = heap->items[--heap->size];
+    size_t i = 0;
+    while (1) {
+        size_t c = 2 * i + 1;
+        if (heap->size <= c) { break; }
+        if ((c + 1 < heap->size) && (heap->items[c].mass < heap->items[c + 1].mass)) { c++; }
+        if (heap->items[c].mass <= last.mass) { break; }
+        heap->items[i] = heap->items[c];
+        i = c;
+    }
+    if (heap->size > 0) { heap->items[i] = last; }
+    return top;
+}
+
+// Evaluate the node `f` into `node`, as `sampler_expand`, and return its
+// midpoint.
+static double table_expand(
+        cdf32_ctx_t cdf
+        , ddf32_ctx_t ddf
+        , const void * ctx
+        , const struct table_frontier * f
+        , struct table_node * node
+        ) {
+    memset(node, 0, sizeof(*node));
+
+    // Compute CDF at midpoint.
+    unsigned int m = DBL_SIZE - (f->l + 1);                 // m = n_max - (len(b)+1)
+    uint64_t b_lex = (f->b << (m + 1)) + (1ull << m) - 1;   // b+'0' + '1'*m
+    double x = int2double(bij64_lex2float(b_lex));
+    bool d_m = 0;
+    if (cdf != NULL) {
+        node->cdf_m = cdf(x, ctx);
+        assert(f->cdf_l <= node->cdf_m);
+        assert(node->cdf_m <= f->cdf_r);
+    } else {
+        ddf(x, ctx, &d_m, &node->cdf_m);
+        assert(compare_lte_ext(f->d_l, f->cdf_l, d_m, node->cdf_m));
+        assert(compare_lte_ext(d_m, node->cdf_m, f->d_r, f->cdf_r));
+    }
+    node->d_m = d_m;
+
+    // Trivial case.
+    if ((d_m == f->d_r) && (node->cdf_m == f->cdf_r)) {
+        node->kind = SAMPLER_LEFT;
+        return x;
+    }
+    if ((d_m == f->d_l) && (node->cdf_m == f->cdf_l)) {
+        node->kind = SAMPLER_RIGHT;
+        return x;
+    }
+
+    // Finite arithmetic case.
+    node->kind = SAMPLER_SPLIT;
+    if (cdf != NULL) {
+        subtract_exact(SUB_0, node->cdf_m, f->cdf_l, &node->ss0);
+        subtract_exact(SUB_0, f->cdf_r, node->cdf_m, &node->ss1);
+    } else {
+        subtract_exact_ext(d_m, node->cdf_m, f->d_l, f->cdf_l, &node->ss0);
+        subtract_exact_ext(f->d_r, f->cdf_r, d_m, node->cdf_m, &node->ss1);
+    }
+    return x;
+}
+
+// Add the children of `node` that have positive mass to the frontier.
+static void table_push_children(
+        struct table_heap * heap
+        , int32_t i
+        , const struct table_node * node
+        , const struct table_frontier * f
+        ) {
+    if (f->l + 1 == DBL_SIZE) {
+        return;
+    }
+    struct table_frontier c = {.parent = i, .l = f->l + 1};
+    if (node->kind != SAMPLER_RIGHT) {
+        c.z = 0; c.b = f->b << 1;
+        c.d_l = f->d_l; c.cdf_l = f->cdf_l;
+        c.d_r = node->d_m; c.cdf_r = node->cdf_m;
+        c.mass = table_position(c.d_r, c.cdf_r) - table_position(c.d_l, c.cdf_l);
+        heap_push(heap, c);
+    }
+    if (node->kind != SAMPLER_LEFT) {
+        c.z = 1; c.b = (f->b << 1) | 1;
+        c.d_l = node->d_m; c.cdf_l = node->cdf_m;
+        c.d_r = f->d_r; c.cdf_r = f->cdf_r;
+        c.mass = table_position(c.d_r, c.cdf_r) - table_position(c.d_l, c.cdf_l);
+        heap_push(heap, c);
+    }
+}
+
+static int table_build_common(
+        cdf32_ctx_t cdf
+        , ddf32_ctx_t ddf
+        , const void * ctx
+        , size_t max_bytes
+        , const char * path
+        ) {
+    bool ext = (cdf == NULL);
+    size_t max_nodes = max(max_bytes / TABLE_NODE_SIZE, (size_t)1);
+    if (INT32_MAX < max_nodes) { max_nodes = INT32_MAX; }
+
+    // Each node adds at most two nodes to the frontier, and removes one.
+    struct table_node * nodes = malloc(max_nodes * sizeof(*nodes));
+    double * xs = malloc(max_nodes * sizeof(*xs));
+    struct table_heap heap = {malloc((max_nodes + 2) * sizeof(*heap.items)), 0};
+    if ((nodes == NULL) || (xs == NULL) || (heap.items == NULL)) {
+        free(nodes); free(xs); free(heap.items);
+        return -1;
+    }
+
+    // Expand the most probable node of the frontier until the table is full.
+    struct table_frontier root = {
+        .mass = 1, .parent = -1, .b = 0, .l = 0,
+        .d_l = 0, .cdf_l = 0, .d_r = ext, .cdf_r = ext ? 0 : 1,
+    };
+    heap_push(&heap, root);
+    size_t num_nodes = 0;
+    while ((num_nodes < max_nodes) && (0 < heap.size)) {
+        struct table_frontier f = heap_pop(&heap);
+        int32_t i = num_nodes++;
+        xs[i] = table_expand(cdf, ddf, ctx, &f, &nodes[i]);
+        if (0 <= f.parent) {
+            nodes[f.parent].child[f.z] = i;
+        }
+        table_push_children(&heap, i, &nodes[i], &f);
+    }
+    free(heap.items);
+
+    // Encode the file.
+    uint32_t num_probes = min(num_nodes, (size_t)RVG_TABLE_PROBES);
+    size_t size = TABLE_HEADER_SIZE
+        + num_probes * TABLE_PROBE_SIZE
+        + num_nodes * TABLE_NODE_SIZE;
+    unsigned char * buf = calloc(size, 1);
+    if (buf == NULL) {
+        free(nodes); free(xs);
+        return -1;
+    }
+    unsigned char * probes = buf + TABLE_HEADER_SIZE;
+    unsigned char * records = probes + num_probes * TABLE_PROBE_SIZE;
+    for (uint32_t k = 0; k < num_probes; k++) {
+        size_t i = (k * num_nodes) / num_probes;
+        unsigned char * p = probes + k * TABLE_PROBE_SIZE;
+        put_u64(p, double_u64(xs[i]));
+        put_u32(p + 8, float_u32(nodes[i].cdf_m));
+        put_u32(p + 12, nodes[i].d_m);
+    }
+    for (size_t i = 0; i < num_nodes; i++) {
+        put_node(records + i * TABLE_NODE_SIZE, &nodes[i]);
+    }
+    memcpy(buf + TABLE_OFF_MAGIC, TABLE_MAGIC, 8);
+    put_u32(buf + TABLE_OFF_VERSION, RVG_TABLE_VERSION);
+    put_u32(buf + TABLE_OFF_EXT, ext);
+    put_u32(buf + TABLE_OFF_NODE_SIZE, TABLE_NODE_SIZE);
+    put_u32(buf + TABLE_OFF_NUM_PROBES, num_probes);
+    put_u64(buf + TABLE_OFF_NUM_NODES, num_nodes);
+    put_u64(buf + TABLE_OFF_FINGERPRINT,
+        table_hash(probes, num_probes * TABLE_PROBE_SIZE, TABLE_HASH_INIT));
+    put_u64(buf + TABLE_OFF_CHECKSUM,
+        table_hash(records, num_nodes * TABLE_NODE_SIZE, TABLE_HASH_INIT));
+    free(nodes);
+    free(xs);
+
+    // Write to a temporary file that replaces `path` once complete, so
+    // that concurrent readers never map a partial table.
+    size_t len = strlen(path) + 16;
+    char * tmp = malloc(len);
+    if (tmp == NULL) { free(buf); return -1; }
+    snprintf(tmp, len, "%s.%ld.tmp", path, (long) getpid());
+    FILE * fp = fopen(tmp, "wb");
+    int ok = (fp != NULL)
+        && (fwrite(buf, 1, size, fp) == size)
+        && (fflush(fp) == 0);
+    if (fp != NULL) { ok = (fclose(fp) == 0) && ok; }
+    ok = ok && (rename(tmp, path) == 0);
+    if (!ok) { remove(tmp); }
+    free(tmp);
+    free(buf);
+    return ok ? 0 : -1;
+}
+
+int rvg_table_build(cdf32_t cdf, size_t max_bytes, const char * path) {
+    return table_build_common(cdf_plain, NULL, &cdf, max_bytes, path);
+}
+
+int rvg_table_build_ext(ddf32_t ddf, size_t max_bytes, const char * path) {
+    return table_build_common(NULL, ddf_plain, &ddf, max_bytes, path);
+}
+
+int rvg_table_build_ctx(cdf32_ctx_t cdf, const void * ctx, size_t max_bytes,
+        const char * path) {
+    return table_build_common(cdf, NULL, ctx, max_bytes, path);
+}
+
+int rvg_table_build_ext_ctx(ddf32_ctx_t ddf, const void * ctx, size_t max_bytes,
+        const char * path) {
+    return table_build_common(NULL, ddf, ctx, max_bytes, path);
+}
+
+// ================ Validation ================
+
+// The nodes are mapped from a file that may be corrupted or replaced, and
+// their checksum is only checked on request, so the walk checks each node
+// that it uses: its kind, the fields of its expansions, and the index of
+// the child that it moves to, which the builder always places after its
+// parent, so that the walk cannot leave the table or cycle.
+
+// Bound on the runs n_1 and n_2 of the expansion of a difference of floats.
+#define TABLE_MAX_RUN (FLT_SIZE_E + FLT_SIZE_M + 128)
+
+// Whether `ss` has the ranges of the output of `subtract_exact`, so that
+// `generate_opt_split` reads its bits within bounds, and positive mass, so
+// that the split terminates.
+static bool table_check_exact(const struct subtract_exact_s * ss) {
+    bool valid = (0 <= ss->n_1) && (ss->n_1 <= TABLE_MAX_RUN)
+        && (0 <= ss->n_2) && (ss->n_2 <= TABLE_MAX_RUN)
+        && (0 <= ss->n_hi) && (ss->n_hi <= FLT_SIZE_M + 2)
+        && (0 <= ss->n_lo) && (ss->n_lo <= FLT_SIZE_M + 1)
+        && ((ss->b_1 == 0) || (ss->b_1 == 1))
+        && ((ss->b_2 == 0) || (ss->b_2 == 1))
+        && (0 <= ss->g_hi) && (ss->g_hi < (1 << ss->n_hi))
+        && (0 <= ss->g_lo) && (ss->g_lo < (1 << ss->n_lo));
+    return valid
+        && ((ss->b_1 && ss->n_1) || ss->g_hi || (ss->b_2 && ss->n_2) || ss->g_lo);
+}
+
+// Whether `c` is a valid child of node `i` in a table of `num_nodes`.
+static bool table_check_child(size_t i, int32_t c, size_t num_nodes) {
+    return (c == 0) || ((i < (size_t) c) && ((size_t) c < num_nodes));
+}
+
+// Whether the node `i` of a table of `num_nodes` is valid.
+static bool table_check_node(const struct table_node * node, size_t i, size_t num_nodes) {
+    switch (node->kind) {
+        case SAMPLER_LEFT:
+        case SAMPLER_RIGHT:
+            break;
+        case SAMPLER_SPLIT:
+            if (!table_check_exact(&node->ss0) || !table_check_exact(&node->ss1)) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+    }
+    return (node->d_m <= 1)
+        && table_check_child(i, node->child[0], num_nodes)
+        && table_check_child(i, node->child[1], num_nodes);
+}
+
+// ================ Loader ================
+
+// Check the header, the fingerprint, and (if `verify`) the checksum and
+// the nodes of a mapped table of `size` bytes.
+static bool table_check(
+        const unsigned char * buf
+        , size_t size
+        , cdf32_ctx_t cdf
+        , ddf32_ctx_t ddf
+        , const void * ctx
+        , bool verify
+        ) {
+    if (size < TABLE_HEADER_SIZE) { return false; }
+    if (memcmp(buf + TABLE_OFF_MAGIC, TABLE_MAGIC, 8) != 0) { return false; }
+    if (get_u32(buf + TABLE_OFF_VERSION) != RVG_TABLE_VERSION) { return false; }
+    if (get_u32(buf + TABLE_OFF_EXT) != (cdf == NULL)) { return false; }
+    if (get_u32(buf + TABLE_OFF_NODE_SIZE) != TABLE_NODE_SIZE) { return false; }
+    uint64_t num_probes = get_u32(buf + TABLE_OFF_NUM_PROBES);
+    uint64_t num_nodes = get_u64(buf + TABLE_OFF_NUM_NODES);
+    if ((num_nodes == 0) || (INT32_MAX < num_nodes)) { return false; }
+    if (size != TABLE_HEADER_SIZE
+            + num_probes * TABLE_PROBE_SIZE
+            + num_nodes * TABLE_NODE_SIZE) {
+        return false;
+    }
+
+    // Fingerprint.
+    const unsigned char * probes = buf + TABLE_HEADER_SIZE;
+    if (table_hash(probes, num_probes * TABLE_PROBE_SIZE, TABLE_HASH_INIT)
+            != get_u64(buf + TABLE_OFF_FINGERPRINT)) {
+        return false;
+    }
+    for (uint64_t k = 0; k < num_probes; k++) {
+        const unsigned char * p = probes + k * TABLE_PROBE_SIZE;
+        uint64_t u = get_u64(p);
+        double x;
+        memcpy(&x, &u, sizeof(x));
+        bool d = 0;
+        float q;
+        if (cdf != NULL) { q = cdf(x, ctx); } else { ddf(x, ctx, &d, &q); }
+        if ((float_u32(q) != get_u32(p + 8)) || (d != get_u32(p + 12))) {
+            return false;
+        }
+    }
+
+    // Checksum.
+    const unsigned char * records = probes + num_probes * TABLE_PROBE_SIZE;
+    if (verify && (table_hash(records, num_nodes * TABLE_NODE_SIZE, TABLE_HASH_INIT)
+            != get_u64(buf + TABLE_OFF_CHECKSUM))) {
+        return false;
+    }
+    if (verify) {
+        for (uint64_t i = 0; i < num_nodes; i++) {
+            struct table_node node;
+            memcpy(&node, records + i * TABLE_NODE_SIZE, sizeof(node));
+            if (!table_check_node(&node, i, num_nodes)) { return false; }
+        }
+    }
+    return true;
+}
+
+// A plain target `cdf32` or `ddf32` is stored in the table, which is then
+// the context of the adapter `cdf` or `ddf`, as in `sampler_alloc_common`.
+static struct rvg_table * table_open_common(
+        const char * path
+        , cdf32_ctx_t cdf
+        , ddf32_ctx_t ddf
+        , const void * ctx
+        , cdf32_t cdf32
+        , ddf32_t ddf32
+        , bool verify
+        ) {
+    // The nodes are used in place, which requires a little-endian host.
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    return NULL;
+#endif
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return NULL; }
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = st.st_size;
+    void * map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) { return NULL; }
+
+    const unsigned char * buf = map;
+    struct rvg_table * table = malloc(sizeof(*table));
+    if (table != NULL) {
+        table->cdf32 = cdf32;
+        table->ddf32 = ddf32;
+        table->ctx = (cdf32 != NULL) ? (const void *) &table->cdf32
+            : (ddf32 != NULL) ? (const void *) &table->ddf32
+            : ctx;
+    }
+    if ((table == NULL) || !table_check(buf, size, cdf, ddf, table->ctx, verify)) {
+        free(table);
+        munmap(map, size);
+        return NULL;
+    }
+    uint32_t num_probes = get_u32(buf + TABLE_OFF_NUM_PROBES);
+    table->cdf = cdf;
+    table->ddf = ddf;
+    table->nodes = (const struct table_node *)
+        (buf + TABLE_HEADER_SIZE + num_probes * TABLE_PROBE_SIZE);
+    table->num_nodes = get_u64(buf + TABLE_OFF_NUM_NODES);
+    table->map = map;
+    table->map_size = size;
+    return table;
+}
+
+struct rvg_table * rvg_table_open(const char * path, cdf32_t cdf, bool verify) {
+    return table_open_common(path, cdf_plain, NULL, NULL, cdf, NULL, verify);
+}
+
+struct rvg_table * rvg_table_open_ext(const char * path, ddf32_t ddf, bool verify) {
+    return table_open_common(path, NULL, ddf_plain, NULL, NULL, ddf, verify);
+}
+
+struct rvg_table * rvg_table_open_ctx(const char * path, cdf32_ctx_t cdf, const void * ctx,
+        bool verify) {
+    return table_open_common(path, cdf, NULL, ctx, NULL, NULL, verify);
+}
+
+struct rvg_table * rvg_table_open_ext_ctx(const char * path, ddf32_ctx_t ddf, const void * ctx,
+        bool verify) {
+    return table_open_common(path, NULL, ddf, ctx, NULL, NULL, verify);
+}
+
+void rvg_table_close(struct rvg_table * table) {
+    munmap(table->map, table->map_size);
+    free(table);
+}
+
+// ================ Generation ================
+
+// As `rvg_sampler_generate_opt`, where the walk leaves the table at the first
+// node that it does not contain, or that is not valid, and finishes with
+// `generate_opt_node` from there. The fields of a node that is not valid
+// are not used, so it only costs the calls to the target below it.
+double rvg_table_generate_opt(const struct rvg_table * table, struct flip_state * prng) {
+
+    // Evolving state.
+    uint64_t b = 0;
+    unsigned int ell = 0;
+    bool ext = (table->cdf == NULL);
+    bool d_l = 0; float cdf_l = 0;
+    bool d_r = ext; float cdf_r = ext ? 0 : 1;
+
+    RVG_STATS_BEGIN(prng);
+
+    int32_t i = 0;
+    unsigned int l = 0;
+    while (1) {
+
+        const struct table_node * node = &table->nodes[i];
+        if (!table_check_node(node, i, table->num_nodes)) {
+            break;
+        }
+
+        // Choose the next bit. The expansions are only read.
+        unsigned char z;
+        switch (node->kind) {
+            case SAMPLER_LEFT:  z = 0; break;
+            case SAMPLER_RIGHT: z = 1; break;
+            default:            z = generate_opt_split(&node->ss0, &node->ss1, &ell, prng);
+        }
+        RVG_STATS_LEVEL((node->kind == SAMPLER_SPLIT) ? RVG_TRACE_SPLIT : RVG_TRACE_TRIVIAL, l, ell);
+
+        // Move to b+'z'.
+        b = (b << 1) | z;
+        if (z == 0) {
+            d_r = node->d_m; cdf_r = node->cdf_m;
+        } else {
+            d_l = node->d_m; cdf_l = node->cdf_m;
+        }
+        l++;
+        if (l == DBL_SIZE) {
+            RVG_STATS_SAMPLE(prng, DBL_SIZE, ell);
+            b = bij64_lex2float(b);
+            return int2double(b);
+        }
+
+        // Leave the table below a leaf.
+        i = node->child[z];
+        if (i == 0) {
+            break;
+        }
+    }
+
+    // Finish from the node b with l active bits. The variate is recorded by
+    // `generate_opt_node`.
+    RVG_STATS_ADD(flips, prng->num_flips - rvg_stats_flips__);
+    return ext
+        ? generate_opt_node_ext_ctx(table->ddf, table->ctx, b, l, ell,
+            d_l, cdf_l, d_r, cdf_r, prng)
+        : generate_opt_node_ctx(table->cdf, table->ctx, b, l, ell, cdf_l, cdf_r, prng);
+}
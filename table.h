@@ -0,0 +1,97 @@
+/*
+  Name:     table.h
+  Purpose:  Memory-mappable tables of the top of the lex tree.
+  Author:   F. Saad
+  Copyright (C) 2025 CMU Probabilistic Computing Systems Lab
+*/
+
+#ifndef TABLE_H
+#define TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arithmetic.h"
+#include "flip.h"
+#include "generate.h"
+#include "sampler.h"
+
+// Version of the file format, which is incremented on any change.
+#define RVG_TABLE_VERSION 1
+
+// Number of midpoints at which the target is evaluated to check a table.
+#define RVG_TABLE_PROBES 16
+
+// Node of a table, laid out as in the file (little endian, 72 bytes), with
+// the fields of `sampler_node` that do not change once it is evaluated.
+struct table_node {
+    int32_t child[2];               // Index of child b+'0', b+'1' (0 if absent).
+    float cdf_m;                    // CDF (or DDF) value at the midpoint.
+    uint8_t d_m;                    // DDF direction at the midpoint (0 or 1).
+    uint8_t kind;                   // Value of enum sampler_kind.
+    uint8_t pad[2];
+    struct subtract_exact_s ss0;    // Mass of b+'0' (SAMPLER_SPLIT only).
+    struct subtract_exact_s ss1;    // Mass of b+'1' (SAMPLER_SPLIT only).
+};
+
+/** A read-only table of the top of the lex tree of a fixed `cdf` or `ddf`,
+    which is mapped from a file. */
+struct rvg_table {
+    cdf32_ctx_t cdf;                    // Target CDF (NULL if ddf is used).
+    ddf32_ctx_t ddf;                    // Target DDF (NULL if cdf is used).
+    const void * ctx;                   // Context of cdf or ddf.
+    cdf32_t cdf32;                      // Plain target CDF, pointed to by ctx (if any).
+    ddf32_t ddf32;                      // Plain target DDF, pointed to by ctx (if any).
+    const struct table_node * nodes;    // Nodes in the mapping, root at index 0.
+    size_t num_nodes;                   // Number of nodes.
+    void * map;                         // Mapping of the file.
+    size_t map_size;                    // Size of the mapping, in bytes.
+};
+
+/** Write to `path` a table of at most `max_bytes` of nodes for `cdf`,
+    which holds the most probable nodes of its lex tree. Returns 0 on
+    success and -1 if the file cannot be written. */
+int rvg_table_build(cdf32_t cdf, size_t max_bytes, const char * path);
+
+/** Write to `path` a table of at most `max_bytes` of nodes for `ddf`. */
+int rvg_table_build_ext(ddf32_t ddf, size_t max_bytes, const char * path);
+
+/** Write to `path` a table of at most `max_bytes` of nodes for `cdf` with
+    context `ctx`. */
+int rvg_table_build_ctx(cdf32_ctx_t cdf, const void * ctx, size_t max_bytes,
+    const char * path);
+
+/** Write to `path` a table of at most `max_bytes` of nodes for `ddf` with
+    context `ctx`. */
+int rvg_table_build_ext_ctx(ddf32_ctx_t ddf, const void * ctx, size_t max_bytes,
+    const char * path);
+
+/** Map the table at `path` for `cdf`. Returns NULL if the file is not a
+    valid table for `cdf`, where the nodes are checksummed and checked only
+    if `verify`. */
+struct rvg_table * rvg_table_open(const char * path, cdf32_t cdf, bool verify);
+
+/** Map the table at `path` for `ddf`. */
+struct rvg_table * rvg_table_open_ext(const char * path, ddf32_t ddf, bool verify);
+
+/** Map the table at `path` for `cdf` with context `ctx`, which must outlive
+    the table. */
+struct rvg_table * rvg_table_open_ctx(const char * path, cdf32_ctx_t cdf, const void * ctx,
+    bool verify);
+
+/** Map the table at `path` for `ddf` with context `ctx`, which must outlive
+    the table. */
+struct rvg_table * rvg_table_open_ext_ctx(const char * path, ddf32_ctx_t ddf, const void * ctx,
+    bool verify);
+
+/** Unmap and free a table. */
+void rvg_table_close(struct rvg_table * table);
+
+/** Generate random variables optimally from a table. A node that is not
+    valid, which can only be reached if the file is corrupted and was opened
+    without `verify`, is treated as absent, and the walk calls the target
+    from there. */
+double rvg_table_generate_opt(const struct rvg_table * table, struct flip_state * prng);
+
+#endif